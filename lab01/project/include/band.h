@@ -0,0 +1,49 @@
+#ifndef LAB01_BAND_H
+#define LAB01_BAND_H
+
+#include <knapsack.h>
+
+/*
+ * Active column window of every DP row.
+ *
+ * Row i (after the first i items in `order`) can only differ from its
+ * right neighbour up to the prefix weight P_i: every column above it holds
+ * the same value. And the trace back, starting from max_weight, never gets
+ * below max_weight minus the weight of the items still to come, so nothing
+ * left of that is ever read. Row i is therefore fully described by the
+ * columns [lo[i], hi[i]], with column j > hi[i] reading as hi[i].
+ */
+typedef struct
+{
+    size_t count;
+
+    size_t   *order;
+    weight_t *lo;
+    weight_t *hi;
+} band_t;
+
+error_t
+init_band(band_t *band, const items_t *items, weight_t max_weight);
+
+void
+drop_band(band_t *band);
+
+// Number of DP cells the band actually covers, rows 1..count.
+size_t
+band_cells(const band_t *band);
+
+#define band_width(band, i) \
+    ((band)->hi[i] - (band)->lo[i] + 1)
+
+#define band_at(band, row, i, j) \
+    ((row)[(((j) < (band)->hi[i]) ? (j) : (band)->hi[i]) - (band)->lo[i]])
+
+#define band_item(band, items, i) \
+    (&(items)->arr[(band)->order[(i) - 1]])
+
+void
+band_row(int_t *cur, weight_t lo, weight_t a, weight_t b,
+         const int_t *prev, weight_t plo, weight_t phi,
+         weight_t w, value_t v);
+
+#endif //LAB01_BAND_H
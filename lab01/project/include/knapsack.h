@@ -2,6 +2,7 @@
 #define LAB01_KNAPSACK_H
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <stdint.h>
 
@@ -57,6 +58,12 @@ init_items(items_t *items)
 error_t
 read_items_info(FILE *f, items_t *items);
 
+error_t
+read_items_count(FILE *f, size_t *count);
+
+error_t
+read_item_info(FILE *f, item_t *item);
+
 error_t
 write_items_info(FILE *f, const items_t *items);
 
@@ -68,10 +75,19 @@ add_random_items_to_items(items_t *items, int_t num_items,
                           int_t item_value_min, int_t item_value_max,
                           int_t item_weight_min, int_t item_weight_max);
 
+// Tuning the engines look up, see tune.h.
+typedef struct tune_cache tune_cache_t;
+
 typedef struct
 {
     items_t  items;
     weight_t max_weight;
+
+    // Copies taken of each of items, NULL unless solved as unbounded.
+    size_t *copies;
+
+    // Not owned, NULL for the default tuning.
+    const tune_cache_t *tunes;
 } knapsack_t;
 
 __always_inline error_t
@@ -85,6 +101,8 @@ __always_inline void
 drop_knapsack(knapsack_t *knapsack)
 {
     drop_items(&knapsack->items);
+    free(knapsack->copies);
+    knapsack->copies = NULL;
 }
 
 error_t
@@ -96,13 +114,67 @@ write_knapsack_info(FILE *f, const knapsack_t *knapsack);
 error_t
 add_item_to_knapsack(knapsack_t *knapsack, const item_t *item);
 
+error_t
+add_copies_to_knapsack(knapsack_t *knapsack, const item_t *item, size_t copies);
+
+typedef error_t (*pack_func_t)(knapsack_t *, double *, const items_t *);
+
 error_t
 pack_knapsack(knapsack_t *knapsack, double *dt, const items_t *items);
 
 error_t
 pack_knapsack_omp(knapsack_t *knapsack, double *dt, const items_t *items);
 
+// A weightless item with a positive value is refused with ARG_ERR.
+error_t
+pack_knapsack_unbounded(knapsack_t *knapsack, double *dt, const items_t *items);
+
+error_t
+pack_knapsack_unbounded_omp(knapsack_t *knapsack, double *dt, const items_t *items);
+
+// Every item is worth its weight: only the best reachable weight matters.
+int
+is_subset_sum(const items_t *items);
+
+error_t
+pack_knapsack_subset(knapsack_t *knapsack, double *dt, const items_t *items);
+
+error_t
+pack_knapsack_subset_omp(knapsack_t *knapsack, double *dt, const items_t *items);
+
+// Rank and size in MPI_COMM_WORLD; 0 and 1, with a zero return, when MPI
+// is not running.
+int
+mpi_world(int *rank, int *size);
+
+// Collective: rank 0 reads the task from f, the others receive it. Without
+// MPI this is a plain read.
+error_t
+read_knapsack_mpi(FILE *f, knapsack_t *knapsack, items_t *items);
+
+// Meet in the middle, for few items and any capacity: 2^(n/2) subsets per
+// half. More items than MITM_MAX_ITEMS (not counting the ones heavier
+// than the knapsack) are refused with ARG_ERR; at the cap the subsets
+// take about 300 MiB.
+#define MITM_MAX_ITEMS 44
+
+// Items meet in the middle works on: the ones not heavier than max_weight.
+size_t
+mitm_items(const items_t *items, weight_t max_weight);
+
+error_t
+pack_knapsack_mitm(knapsack_t *knapsack, double *dt, const items_t *items);
+
 error_t
 pack_knapsack_mpi(knapsack_t *knapsack, double *dt, const items_t *items);
 
+error_t
+pack_knapsack_mpi_rma(knapsack_t *knapsack, double *dt, const items_t *items);
+
+error_t
+pack_knapsack_mpi_pipeline(knapsack_t *knapsack, double *dt, const items_t *items);
+
+error_t
+pack_knapsack_mpi_cols(knapsack_t *knapsack, double *dt, const items_t *items);
+
 #endif //LAB01_KNAPSACK_H
@@ -7,4 +7,29 @@
 
 #define elif else if
 
+#define min(x, y) \
+    (((x) < (y)) ? (x) : (y))
+
+#define max(x, y) \
+    (((x) > (y)) ? (x) : (y))
+
+// Sum of two int_t that sticks at the maximum instead of wrapping.
+#define sat_add(x, y) \
+    (((x) > UINT64_MAX - (y)) ? UINT64_MAX : (x) + (y))
+
+// Format of int_t, weight_t and value_t.
+#define INT_FMT "%lu"
+
+// Bit sets are arrays of 64-bit words, bit k in word k / WORD_BITS.
+#define WORD_BITS 64
+
+#define bit_words(n) \
+    (((n) + WORD_BITS - 1) / WORD_BITS)
+
+#define test_bit(bits, k) \
+    (((bits)[(k) / WORD_BITS] >> ((k) % WORD_BITS)) & 1)
+
+#define set_bit(bits, k) \
+    ((bits)[(k) / WORD_BITS] |= 1ULL << ((k) % WORD_BITS))
+
 #endif //LAB01_MACRO_H
@@ -0,0 +1,35 @@
+#ifndef LAB01_PLAN_H
+#define LAB01_PLAN_H
+
+#include "knapsack.h"
+
+/*
+ * Predicted cost of running one engine on one instance. The figures come
+ * from a coarse cost model (ns per DP cell, per-row and per-message
+ * overheads), good enough to rank engines, not to promise wall time.
+ */
+typedef struct
+{
+    const char *name;
+    pack_func_t pack;
+
+    double time;
+    // Bytes per rank.
+    double memory;
+    int fits;
+} plan_t;
+
+// Picks the cheapest engine whose memory fits into the available RAM,
+// logging the estimates to log unless it is NULL. Collective over
+// MPI_COMM_WORLD when MPI is running: every rank ends up with rank 0's
+// plan. Without MPI only the single-process engines are considered.
+error_t
+plan_knapsack(plan_t *plan, const knapsack_t *knapsack, const items_t *items,
+              FILE *log);
+
+// Plans, logs the choice to log (unless NULL) and dispatches to it.
+error_t
+pack_knapsack_auto(knapsack_t *knapsack, double *dt, const items_t *items,
+                   FILE *log);
+
+#endif //LAB01_PLAN_H
@@ -0,0 +1,51 @@
+#ifndef LAB01_PROFILE_H
+#define LAB01_PROFILE_H
+
+#include <stdio.h>
+
+#include "knapsack.h"
+
+/*
+ * Optimum for every capacity 0..max_weight from a single solve.
+ *
+ * The last DP row already holds all of them, so it is kept as best[], and
+ * instead of the table only its decision bits are: bit c of row i is set
+ * iff item i is taken in the optimum of the first i items at capacity c.
+ * Any capacity can then be traced back later without solving again, at
+ * one bit per cell.
+ */
+typedef struct
+{
+    weight_t max_weight;
+    size_t count;
+
+    value_t *best;
+
+    // Row i covers the capacities 0..hi[i]: above that, all of the first
+    // i items fit and the optimum stays the same.
+    weight_t *hi;
+
+    size_t words;
+    uint64_t *keep;
+} profile_t;
+
+// tunes may be NULL for the default tuning.
+error_t
+solve_profile(profile_t *profile, double *dt,
+              const items_t *items, weight_t max_weight,
+              const tune_cache_t *tunes);
+
+void
+drop_profile(profile_t *profile);
+
+// Fills knapsack with an optimal item set for capacity (at most max_weight).
+error_t
+trace_profile(knapsack_t *knapsack, const profile_t *profile,
+              const items_t *items, weight_t capacity);
+
+// Writes "capacity value" lines, only those where the optimum grows if
+// breakpoints is set: the profile is a step function between them.
+error_t
+write_profile(FILE *f, const profile_t *profile, int breakpoints);
+
+#endif //LAB01_PROFILE_H
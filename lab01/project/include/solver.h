@@ -0,0 +1,77 @@
+#ifndef LAB01_SOLVER_H
+#define LAB01_SOLVER_H
+
+#include <stdio.h>
+
+#include "knapsack.h"
+
+/*
+ * Embeddable entry point of libknapsack.
+ *
+ * A solver owns one task: its capacity, its items and the last result.
+ * Nothing is shared between solvers, so different solvers may parse and
+ * solve concurrently from different threads; a single solver is not
+ * thread-safe. The MPI engines and autotune_knapsack() additionally need
+ * MPI to be initialised and run collectively, as they do in the CLI; the
+ * planner and solver_read_mpi() fall back to a single process without it.
+ */
+typedef struct solver solver_t;
+
+solver_t *
+create_solver(void);
+
+void
+destroy_solver(solver_t *solver);
+
+// Read the tuning cache (see tune.h) once, for all later solves; until
+// then the engines run with the default tuning.
+error_t
+solver_load_tune(solver_t *solver, const char *path);
+
+// Replace the task with the one read from f or from buf[0..len).
+error_t
+solver_read(solver_t *solver, FILE *f);
+
+// Collective over MPI_COMM_WORLD, f is only read (and needed) on rank 0.
+error_t
+solver_read_mpi(solver_t *solver, FILE *f);
+
+error_t
+solver_parse(solver_t *solver, const char *buf, size_t len);
+
+// Replace the task with max_weight and a copy of items.
+error_t
+solver_set_task(solver_t *solver, weight_t max_weight, const items_t *items);
+
+// Solve the task with pack; the previous result is discarded.
+error_t
+solver_solve(solver_t *solver, pack_func_t pack);
+
+// Read, solve and write a task in one overlapped pass, see stream.h.
+error_t
+solver_stream(solver_t *solver, FILE *src, FILE *dst);
+
+// Write the result in the task output format, to f or to a malloc'ed *buf.
+error_t
+solver_write(const solver_t *solver, FILE *f);
+
+error_t
+solver_format(const solver_t *solver, char **buf, size_t *len);
+
+weight_t
+solver_max_weight(const solver_t *solver);
+
+const items_t *
+solver_items(const solver_t *solver);
+
+const knapsack_t *
+solver_result(const solver_t *solver);
+
+// Wall time of the last solve, as reported by the engine.
+const tune_cache_t *
+solver_tunes(const solver_t *solver);
+
+double
+solver_duration(const solver_t *solver);
+
+#endif //LAB01_SOLVER_H
@@ -0,0 +1,20 @@
+#ifndef LAB01_STREAM_H
+#define LAB01_STREAM_H
+
+#include <stdio.h>
+
+#include "knapsack.h"
+
+/*
+ * Reads and solves a task with the two stages overlapped: a reader thread
+ * parses items into a lock-free ring and the OpenMP solver turns them into
+ * DP rows as soon as they arrive. The output depends on the trace back, so
+ * it cannot be streamed; a writer thread only overlaps writing it with
+ * tearing the table down.
+ *
+ * dt covers the whole read-solve-write path.
+ */
+error_t
+stream_knapsack(FILE *src, FILE *dst, knapsack_t *knapsack, double *dt);
+
+#endif //LAB01_STREAM_H
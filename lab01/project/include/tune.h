@@ -0,0 +1,85 @@
+#ifndef LAB01_TUNE_H
+#define LAB01_TUNE_H
+
+#include "knapsack.h"
+
+/*
+ * Runtime tuning knobs of the parallel solvers. The best values depend on
+ * the host (core count, cache sizes) and on the shape of the instance, so
+ * they are calibrated per machine and per (W, n) bucket by --autotune and
+ * kept in a small text cache. The cache is read once into a tune_cache_t
+ * which the engines then look their bucket up in.
+ */
+typedef struct
+{
+    int    num_threads;
+    size_t block_rows;
+    size_t block_cols;
+} tune_t;
+
+#define DEFAULT_BLOCK_ROWS 32
+#define DEFAULT_BLOCK_COLS 256
+
+// Autotuning times a sample of the task of at most this many items and
+// capacities. The cache is keyed on the sample's shape, so every larger
+// instance shares the buckets of the largest sample.
+#define TUNE_SAMPLE_ITEMS 1024
+#define TUNE_SAMPLE_COLS  ((weight_t)1 << 15)
+
+// The cache lives in $LAB01_TUNE_FILE, or in $HOME/.lab01.tune if unset.
+#define TUNE_FILE_ENV  "LAB01_TUNE_FILE"
+#define TUNE_FILE_NAME ".lab01.tune"
+
+typedef struct
+{
+    unsigned wb;
+    unsigned nb;
+    tune_t tune;
+} tune_entry_t;
+
+// The entries of this machine.
+struct tune_cache
+{
+    size_t count;
+    tune_entry_t *arr;
+};
+
+void
+default_tune(tune_t *tune);
+
+// Reads the entries of this machine from path, or from tune_file_path()
+// if path is NULL. A missing cache is an empty one.
+error_t
+load_tune_cache(tune_cache_t *cache, const char *path);
+
+void
+drop_tune_cache(tune_cache_t *cache);
+
+// Falls back to the defaults when cache is NULL or has no matching entry.
+void
+find_tune(tune_t *tune, const tune_cache_t *cache,
+          weight_t max_weight, size_t num_items);
+
+// Collective over MPI_COMM_WORLD (if MPI is running): everybody gets rank
+// 0's answer. Ranks on different hosts may see different caches (or none),
+// and the MPI engines deadlock unless all agree on the blocking.
+void
+find_tune_mpi(tune_t *tune, const tune_cache_t *cache,
+              weight_t max_weight, size_t num_items);
+
+error_t
+save_tune(const char *path, const tune_t *tune,
+          weight_t max_weight, size_t num_items);
+
+// Times short solves of a sample of the task over the parameter grid and
+// returns the fastest configuration, logging every probe to log unless it
+// is NULL. Collective over MPI_COMM_WORLD.
+error_t
+autotune_knapsack(tune_t *best, weight_t max_weight, const items_t *items,
+                  FILE *log);
+
+// The cache path, either $LAB01_TUNE_FILE or built into path[0..size).
+const char *
+tune_file_path(char *path, size_t size);
+
+#endif //LAB01_TUNE_H
@@ -0,0 +1,147 @@
+#include <assert.h>
+#include <stdlib.h>
+
+#include <macro.h>
+#include <band.h>
+
+static void
+fill_bounds(band_t *band, const items_t *items, weight_t max_weight)
+{
+    const size_t n = band->count;
+
+    weight_t prefix = 0;
+    band->hi[0] = 0;
+    for (size_t i = 1; i <= n; ++i)
+    {
+        prefix = sat_add(prefix, items->arr[band->order[i - 1]].weight);
+        band->hi[i] = min(prefix, max_weight);
+    }
+
+    weight_t suffix = 0;
+    for (size_t i = n + 1; i-- > 0;)
+    {
+        band->lo[i] = (suffix < max_weight) ? max_weight - suffix : 0;
+        band->lo[i] = min(band->lo[i], band->hi[i]);
+
+        if (i > 0)
+            suffix = sat_add(suffix, items->arr[band->order[i - 1]].weight);
+    }
+}
+
+size_t
+band_cells(const band_t *band)
+{
+    size_t cells = 0;
+    for (size_t i = 1; i <= band->count; ++i)
+        cells += band_width(band, i);
+    return cells;
+}
+
+// Sort keys carry their own weight, so the comparator needs no context.
+typedef struct
+{
+    weight_t weight;
+    size_t   index;
+} sort_key_t;
+
+static int
+cmp_by_weight(const void *a, const void *b)
+{
+    const weight_t wa = ((const sort_key_t *)a)->weight;
+    const weight_t wb = ((const sort_key_t *)b)->weight;
+    return (wa > wb) - (wa < wb);
+}
+
+error_t
+init_band(band_t *band, const items_t *items, weight_t max_weight)
+{
+    assert(band && items);
+
+    const size_t n = items->count;
+    memset(band, 0, sizeof(band_t));
+    band->count = n;
+
+    band->order = malloc((n + 1) * sizeof(size_t));
+    band->lo = malloc((n + 1) * sizeof(weight_t));
+    band->hi = malloc((n + 1) * sizeof(weight_t));
+
+    sort_key_t *sorted = malloc((n + 1) * sizeof(sort_key_t));
+    if (!band->order || !band->lo || !band->hi || !sorted)
+    {
+        free(sorted);
+        drop_band(band);
+        return MEM_ERR;
+    }
+
+    for (size_t i = 0; i < n; ++i)
+    {
+        band->order[i] = i;
+        sorted[i] = (sort_key_t){ items->arr[i].weight, i };
+    }
+
+    fill_bounds(band, items, max_weight);
+    const size_t input_cells = band_cells(band);
+
+    // Light items at both ends keep the prefix small at the top and the
+    // suffix small at the bottom, so the window stays narrow.
+    qsort(sorted, n, sizeof(sort_key_t), cmp_by_weight);
+
+    for (size_t i = 0, l = 0, r = n; i < n; ++i)
+        band->order[(i % 2) ? --r : l++] = sorted[i].index;
+
+    fill_bounds(band, items, max_weight);
+    if (band_cells(band) > input_cells)
+    {
+        for (size_t i = 0; i < n; ++i)
+            band->order[i] = i;
+        fill_bounds(band, items, max_weight);
+    }
+
+    free(sorted);
+    return OK;
+}
+
+void
+drop_band(band_t *band)
+{
+    free(band->hi);
+    free(band->lo);
+    free(band->order);
+    memset(band, 0, sizeof(band_t));
+}
+
+void
+band_row(int_t *cur, weight_t lo, weight_t a, weight_t b,
+         const int_t *prev, weight_t plo, weight_t phi,
+         weight_t w, value_t v)
+{
+    weight_t j = a;
+
+    // The item does not fit yet: a plain copy of the previous row.
+    const weight_t copy_end = min(b + 1, w);
+    if (j < copy_end)
+    {
+        const weight_t direct_end = min(copy_end, phi + 1);
+        if (j < direct_end)
+        {
+            memcpy(cur + (j - lo), prev + (j - plo), (direct_end - j) * sizeof(int_t));
+            j = direct_end;
+        }
+        for (; j < copy_end; ++j)
+            cur[j - lo] = prev[phi - plo];
+    }
+
+    for (const weight_t e = min(b, phi); j <= e; ++j)
+    {
+        const int_t x = prev[j - plo];
+        const int_t y = prev[j - w - plo] + v;
+        cur[j - lo] = (x < y) ? y : x;
+    }
+
+    for (; j <= b; ++j)
+    {
+        const int_t x = prev[phi - plo];
+        const int_t y = prev[min(j - w, phi) - plo] + v;
+        cur[j - lo] = (x < y) ? y : x;
+    }
+}
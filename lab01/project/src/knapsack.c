@@ -3,15 +3,14 @@
 #include <stdlib.h>
 
 #include <omp.h>
-#include <mpi.h>
-
 #include <macro.h>
 #include <knapsack.h>
+#include <band.h>
+#include <tune.h>
 
-#define BUF_SIZE 16
-
-static char
-file_str_buff[BUF_SIZE];
+// Lines are parsed from a buffer on the caller's stack, so readers on
+// different files may run concurrently. Long enough for two 64-bit numbers.
+#define BUF_SIZE 48
 
 static error_t
 read_unsigned_long(FILE *f, unsigned long *x);
@@ -19,15 +18,15 @@ read_unsigned_long(FILE *f, unsigned long *x);
 static error_t
 parse_unsigned_long(unsigned long *x, const char *buff);
 
-static error_t
-read_item_info(FILE *f, item_t *item);
-
 #define ULPTR(x) \
     ((unsigned long *)(&x))
 
 #define ITEMPTR(x) \
     ((item_t *)(&x))
 
+static error_t
+write_copies_info(FILE *f, const items_t *items, const size_t *copies);
+
 error_t
 read_knapsack_info(FILE *f, knapsack_t *knapsack)
 {
@@ -39,7 +38,10 @@ error_t
 write_knapsack_info(FILE *f, const knapsack_t *knapsack)
 {
     assert(f && knapsack);
-    return write_items_info(f, &knapsack->items);
+    if (!knapsack->copies)
+        return write_items_info(f, &knapsack->items);
+
+    return write_copies_info(f, &knapsack->items, knapsack->copies);
 }
 
 error_t
@@ -47,13 +49,16 @@ read_items_info(FILE *f, items_t *items)
 {
     assert(f);
 
-    error_t err = read_unsigned_long(f, ULPTR(items->capacity));
+    error_t err = read_items_count(f, &items->capacity);
     if (err != OK)
         return err;
 
-    item_ptr_t new_arr = (item_t*)realloc(items->arr, items->capacity * sizeof(item_t));
+    // An empty task still keeps one slot, realloc(p, 0) would free p.
+    const size_t new_cap = items->capacity ? items->capacity : INITIAL_ITEMS_CAPACITY;
+    item_ptr_t new_arr = (item_t*)realloc(items->arr, new_cap * sizeof(item_t));
     if (!new_arr)
 	    return MEM_ERR;
+    items->arr = new_arr;
 
     for (size_t i = 0; i < items->capacity; ++i)
     {
@@ -65,12 +70,19 @@ read_items_info(FILE *f, items_t *items)
         }
     }
 
-    items->arr = new_arr;
     items->count = items->capacity;
+    items->capacity = new_cap;
 
     return OK;
 }
 
+error_t
+read_items_count(FILE *f, size_t *count)
+{
+    assert(f && count);
+    return read_unsigned_long(f, ULPTR(*count));
+}
+
 #define rand_range(min, max) \
     ((rand() % ((max) - (min))) + (min))
 
@@ -93,8 +105,6 @@ add_random_items_to_items(items_t *items, int_t num_items,
     return OK;
 }
 
-#define INT_FMT "%lu"
-
 #define write_and_check(fmt, ...)               \
     do {                                        \
         if (fprintf(f, fmt, ##__VA_ARGS__) < 1) \
@@ -120,6 +130,24 @@ write_items_info(FILE *f, const items_t *items)
     return OK;
 }
 
+static error_t
+write_copies_info(FILE *f, const items_t *items, const size_t *copies)
+{
+    assert(f && items && copies);
+
+    write_and_check(INT_FMT" "INT_FMT"\n",
+            items->total_weight, items->total_value);
+
+    write_and_check(INT_FMT"\n", items->count);
+    for (size_t i = 0; i < items->count; ++i)
+    {
+        write_and_check(INT_FMT" "INT_FMT" "INT_FMT"\n",
+                items->arr[i].weight, items->arr[i].value, copies[i]);
+    }
+
+    return OK;
+}
+
 error_t
 add_item_to_items(items_t *items, const item_t *item)
 {
@@ -148,6 +176,7 @@ read_unsigned_long(FILE *f, unsigned long *x)
 {
     assert(f && x);
 
+    char file_str_buff[BUF_SIZE];
     if (!fgets(file_str_buff, BUF_SIZE, f))
         return FIO_ERR;
 
@@ -167,11 +196,12 @@ parse_unsigned_long(unsigned long *x, const char *buff)
     return OK;
 }
 
-static error_t
+error_t
 read_item_info(FILE *f, item_t *item)
 {
     assert(f);
 
+    char file_str_buff[BUF_SIZE];
     if (!fgets(file_str_buff, BUF_SIZE, f))
         return FIO_ERR;
 
@@ -207,6 +237,29 @@ add_item_to_knapsack(knapsack_t *knapsack, const item_t *item)
     return add_item_to_items(&knapsack->items, item);
 }
 
+error_t
+add_copies_to_knapsack(knapsack_t *knapsack, const item_t *item, size_t copies)
+{
+    assert(knapsack && item && copies);
+
+    error_t err = add_item_to_knapsack(knapsack, item);
+    if (err != OK)
+        return err;
+
+    size_t *new_copies = realloc(knapsack->copies,
+                                 knapsack->items.capacity * sizeof(size_t));
+    if (!new_copies)
+        return MEM_ERR;
+
+    knapsack->copies = new_copies;
+    knapsack->copies[knapsack->items.count - 1] = copies;
+
+    knapsack->items.total_value  += (copies - 1) * item->value;
+    knapsack->items.total_weight += (copies - 1) * item->weight;
+
+    return OK;
+}
+
 static void
 free_matrix(int_t **m, size_t rc);
 
@@ -224,18 +277,17 @@ free_matrix(int_t **m, size_t rc);
     } while(0)
 
 static error_t
-alloc_matrix(int_t ***m, size_t rc, size_t cc, int clean)
+alloc_band_matrix(int_t ***m, const band_t *band)
 {
-    assert(m && rc && cc);
+    assert(m && band);
 
+    const size_t rc = band->count + 1;
     int_t **mn = (int_t **)calloc(sizeof(int_t *), rc);
     if (!mn)
         return MEM_ERR;
 
-    if (clean)
-        __alloc_rows__(mn, rc, calloc(cc, sizeof(int_t)));
-    else
-        __alloc_rows__(mn, rc, malloc(cc * sizeof(int_t)));
+    __alloc_rows__(mn, rc, malloc(band_width(band, i) * sizeof(int_t)));
+    mn[0][0] = 0;
 
     *m = mn;
     return OK;
@@ -259,56 +311,74 @@ free_matrix(int_t **m, size_t rc)
             printf("%s", "\n");        \
     } while(0);
 
+static void
+trace_band(knapsack_t *knapsack, const items_t *items,
+           const band_t *band, int_t **pm)
+{
+    unsigned char *chosen = calloc(items->count + 1, 1);
+    if (!chosen)
+        return;
+
+    weight_t w = knapsack->max_weight;
+    for (size_t i = items->count; i > 0; --i)
+    {
+        if (band_at(band, pm[i], i, w) != band_at(band, pm[i - 1], i - 1, w))
+        {
+            chosen[band->order[i - 1]] = 1;
+            w -= band_item(band, items, i)->weight;
+        }
+    }
+
+    for (size_t i = items->count; i > 0; --i)
+        if (chosen[i - 1])
+            add_item_to_knapsack(knapsack, &items->arr[i - 1]);
+
+    free(chosen);
+}
+
 error_t
 pack_knapsack(knapsack_t *knapsack, double *dt, const items_t *items)
 {
     assert(knapsack && items);
 
+    band_t band = new(band_t);
+    error_t err = init_band(&band, items, knapsack->max_weight);
+    if (err != OK)
+        return err;
+
     int_t **pm = NULL;
     const size_t num_rows = items->count + 1;
-    const size_t num_cols = knapsack->max_weight + 1;
 
-    error_t err = alloc_matrix(&pm, num_rows, num_cols, 1);
+    err = alloc_band_matrix(&pm, &band);
     if (err != OK)
-        return err;
+        goto out;
 
 #ifdef __LOG_STAT__
     puts("Task stat:");
-    printf("num_rows=%lu, num_cols=%lu\n", num_rows, num_cols);
+    printf("num_rows=%lu, num_cols=%lu\n", num_rows, knapsack->max_weight + 1);
     printnl(1);
 #endif
 
     double t1 = omp_get_wtime();
 
-    for (int_t i = 1; i < num_rows; i++)
+    for (size_t i = 1; i < num_rows; i++)
     {
-        for (int_t j = 0; j < num_cols; j++)
-        {
-            pm[i][j] = pm[i - 1][j];
-
-            if ((j >= items->arr[i - 1].weight) &&
-                    (pm[i][j] < pm[i - 1][j - items->arr[i - 1].weight] + items->arr[i - 1].value))
-            {
-                pm[i][j] = pm[i - 1][j - items->arr[i - 1].weight] + items->arr[i - 1].value;
-            }
-        }
+        const item_t *item = band_item(&band, items, i);
+        band_row(pm[i], band.lo[i], band.lo[i], band.hi[i],
+                 pm[i - 1], band.lo[i - 1], band.hi[i - 1],
+                 item->weight, item->value);
     }
 
-    size_t w = knapsack->max_weight;
-    for (int_t n = items->count; n > 0; --n)
-    {
-        if (pm[n][w] != pm[n - 1][w])
-        {
-            w -= items->arr[n - 1].weight;
-            add_item_to_knapsack(knapsack, &items->arr[n - 1]);
-        }
-    }
+    trace_band(knapsack, items, &band, pm);
 
     double t2 = omp_get_wtime();
     *dt = t2 - t1;
 
     free_matrix(pm, num_rows);
-    return OK;
+
+out:
+    drop_band(&band);
+    return err;
 }
 
 error_t
@@ -316,159 +386,68 @@ pack_knapsack_omp(knapsack_t *knapsack, double *dt, const items_t *items)
 {
     assert(knapsack && items);
 
+    band_t band = new(band_t);
+    error_t err = init_band(&band, items, knapsack->max_weight);
+    if (err != OK)
+        return err;
+
     int_t **pm = NULL;
     const size_t num_rows = items->count + 1;
-    const size_t num_cols = knapsack->max_weight + 1;
 
-    error_t err = alloc_matrix(&pm, num_rows, num_cols, 1);
+    err = alloc_band_matrix(&pm, &band);
     if (err != OK)
-        return err;
+        goto out;
+
+    tune_t tune;
+    find_tune(&tune, knapsack->tunes, knapsack->max_weight, items->count);
 
     omp_set_dynamic(1);
 
 #ifdef __LOG_STAT__
     puts("Task stat:");
-    printf("num_rows=%lu, num_cols=%lu\n", num_rows, num_cols);
+    printf("num_rows=%lu, num_cols=%lu\n", num_rows, knapsack->max_weight + 1);
     printnl(1);
 
     puts("OpenMP stat:");
-    printf("num_proc=%d, max_threads=%d\n",
-           omp_get_num_procs(), omp_get_max_threads());
+    printf("num_proc=%d, max_threads=%d, tuned_threads=%d\n",
+           omp_get_num_procs(), omp_get_max_threads(), tune.num_threads);
     printf("dynamic=%d, nested=%d\n",
            omp_get_dynamic(), omp_get_nested());
     printnl(1);
 #endif
 
-    int_t j = 0;
-    int_t prev_row_value = 0;
-
     double t1 = omp_get_wtime();
 
-    for (int_t i = 1; i < num_rows; ++i)
+    #pragma omp parallel default(shared) num_threads(tune.num_threads)
     {
-        #pragma omp parallel default(shared) private(j, prev_row_value)
-        {
-            #pragma omp for
-            for (j = 0; j < num_cols; ++j)
-            {
-                pm[i][j] = pm[i - 1][j];
-                prev_row_value = pm[i - 1][j - items->arr[i - 1].weight] +
-                        items->arr[i - 1].value;
-
-                if ((j >= items->arr[i - 1].weight) && (pm[i][j] < prev_row_value))
-                    pm[i][j] = prev_row_value;
-            }
-        }
-    }
+        const int num_threads = omp_get_num_threads();
+        const int thread = omp_get_thread_num();
 
-    size_t w = knapsack->max_weight;
-    for (int_t n = items->count; n > 0; --n)
-    {
-        if (pm[n][w] != pm[n - 1][w])
+        for (size_t i = 1; i < num_rows; ++i)
         {
-            w -= items->arr[n - 1].weight;
-            add_item_to_knapsack(knapsack, &items->arr[n - 1]);
-        }
-    }
+            const item_t *item = band_item(&band, items, i);
+            const weight_t width = band_width(&band, i);
 
-    double t2 = omp_get_wtime();
-    *dt = t2 - t1;
+            const weight_t a = band.lo[i] + width * thread / num_threads;
+            const weight_t b = band.lo[i] + width * (thread + 1) / num_threads;
 
-    free_matrix(pm, num_rows);
-    return OK;
-}
-
-#define ROW 32
-#define COL 256
-
-#define min(x, y) \
-    (((x) < (y)) ? (x) : (y))
-
-void
-solve_mpi(int n, int c,
-          int rows, const items_t *items,
-          int start, int rank, int size);
-
-error_t
-pack_knapsack_mpi(knapsack_t *knapsack, double *dt, const items_t *items)
-{
-    int size, rank;
-    MPI_Comm_size(MPI_COMM_WORLD, &size);
-    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+            if (a < b)
+                band_row(pm[i], band.lo[i], a, b - 1,
+                         pm[i - 1], band.lo[i - 1], band.hi[i - 1],
+                         item->weight, item->value);
 
-    for (int i = 0; i < items->count; i += ROW)
-    {
-        int rows  = min(ROW, items->count - i);
-        if ((i / ROW) % size == rank)
-            solve_mpi(items->count, knapsack->max_weight,
-                      rows, items, i, rank, size);
+            #pragma omp barrier
+        }
     }
-}
 
-void
-solve_mpi(int n, int c,
-          int rows, const items_t *items,
-          int start, int rank, int size)
-{
-    int recv_rank = (rank-1)%size;
-    int send_rank = (rank+1)%size;
-    if (start == 0)
-    {
-        int i, j;
-        int **mp = malloc(sizeof(int [rows][c]));
+    trace_band(knapsack, items, &band, pm);
 
-        for (j = 0; j < c; j += COL)
-        {
-            int cols = min(COL, c-j);
-            int k;
-            for (k = j; k < j + cols; k++) {
-                if (items->arr[0].weight > k) {
-                    mp[0][k] = 0;
-                } else {
-                    mp[0][k] = items->arr[0].value;
-                }
-            }
-            for (i = 1; i < rows; i++) {
-                for (k = j; k < j + cols; k++) {
-                    if ( (k<items->arr[i].weight) ||
-                         (mp[i-1][k] >= mp[i-1][k-items->arr[i].weight] + items->arr[i].value)) {
-                        mp[i][k] = mp[i-1][k];
-                    } else {
-                        mp[i][k] = mp[i-1][k-items->arr[i].weight] + items->arr[i].value;
-                    }
-                }
-            }
-            MPI_Send(&mp[rows-1][j], cols, MPI_INT, send_rank, j, MPI_COMM_WORLD);
-        }
+    double t2 = omp_get_wtime();
+    *dt = t2 - t1;
 
-        free(mp);
-    } else {
-        int **mp = malloc(sizeof(int [rows+1][c]));
-
-        int i, j;
-        for (j = 0; j < c; j += COL) {
-            int cols = min(COL, c-j);
-            int k;
-            MPI_Recv(&mp[0][j], cols, MPI_INT, recv_rank, j, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
-            for (i = 1; i <= rows; i++) {
-                for (k = j; k < j + cols; k++) {
-                    int ni = i-1;
-                    if ( (k<items->arr[ni].weight) ||
-                         (mp[i-1][k] >= mp[i-1][k-items->arr[ni].weight] + items->arr[ni].value)) {
-                        mp[i][k] = mp[i-1][k];
-                    } else {
-                        mp[i][k] = mp[i-1][k-items->arr[ni].weight] + items->arr[ni].value;
-                    }
-                }
-            }
-
-            if (start + rows == n && j + cols == c) {
-                //TODO handle max value
-            } else if (start + rows != n){
-                MPI_Send(&mp[rows][j], cols, MPI_INT, send_rank, j, MPI_COMM_WORLD);
-            }
-        }
+    free_matrix(pm, num_rows);
 
-        free(mp);
-    }
+out:
+    drop_band(&band);
+    return err;
 }
@@ -0,0 +1,741 @@
+#include <assert.h>
+#include <stdlib.h>
+
+#include <mpi.h>
+
+#include <macro.h>
+#include <knapsack.h>
+#include <band.h>
+#include <tune.h>
+
+#define MPI_INT_T MPI_UINT64_T
+
+#define BOUNDARY_TAG 0
+#define TRACE_TAG    1
+#define HALO_TAG     2
+
+/*
+ * Items are cut into blocks of block_rows rows that are dealt to the ranks
+ * round-robin. A block needs the last row of the previous block (the
+ * boundary row), which arrives from the previous rank in block_cols-wide
+ * chunks, so rank r can start on chunk j as soon as rank r - 1 is done
+ * with it. Both block sizes come from the tuning cache.
+ *
+ * How the boundary chunks travel is up to the transport.
+ */
+typedef struct transport transport_t;
+
+struct transport
+{
+    error_t (*init)(transport_t *t, size_t num_cols);
+
+    // Publishes [off, off + cnt) of the last row of block `block` to the
+    // owner of block + 1.
+    void (*send)(transport_t *t, const int_t *row,
+                 size_t off, size_t cnt, size_t block);
+
+    // Waits for [off, off + cnt) of the boundary row of block `block` and
+    // returns the whole (partially filled) boundary row.
+    const int_t *(*recv)(transport_t *t,
+                         size_t off, size_t cnt, size_t block);
+
+    // Completes all outgoing chunks of the current block.
+    void (*flush)(transport_t *t);
+
+    void (*drop)(transport_t *t);
+
+    int rank;
+    int size;
+    size_t num_cols;
+    size_t chunk;
+
+    int_t *boundary;
+
+    MPI_Request *reqs;
+    size_t num_reqs;
+
+    MPI_Win win;
+    int_t *win_base;
+    int shared;
+};
+
+static error_t
+p2p_init(transport_t *t, size_t num_cols)
+{
+    t->boundary = malloc(num_cols * sizeof(int_t));
+    t->reqs = malloc(((num_cols + t->chunk - 1) / t->chunk) * sizeof(MPI_Request));
+    if (!t->boundary || !t->reqs)
+        return MEM_ERR;
+
+    return OK;
+}
+
+static void
+p2p_send(transport_t *t, const int_t *row,
+         size_t off, size_t cnt, size_t block)
+{
+    (void)block;
+    MPI_Isend(row + off, cnt, MPI_INT_T, (t->rank + 1) % t->size,
+              BOUNDARY_TAG, MPI_COMM_WORLD, &t->reqs[t->num_reqs++]);
+}
+
+static const int_t *
+p2p_recv(transport_t *t, size_t off, size_t cnt, size_t block)
+{
+    (void)block;
+    MPI_Recv(t->boundary + off, cnt, MPI_INT_T, (t->rank + t->size - 1) % t->size,
+             BOUNDARY_TAG, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+    return t->boundary;
+}
+
+static void
+p2p_flush(transport_t *t)
+{
+    MPI_Waitall(t->num_reqs, t->reqs, MPI_STATUSES_IGNORE);
+    t->num_reqs = 0;
+}
+
+static void
+p2p_drop(transport_t *t)
+{
+    free(t->reqs);
+    free(t->boundary);
+}
+
+/*
+ * Every rank exposes two boundary slots followed by one flag per chunk and
+ * slot. The sender puts a chunk straight into the receiver's slot and then
+ * raises its flag to the receiving block + 1; the receiver computes from
+ * the slot in place. Two slots are enough: the sender cannot produce the
+ * input for the receiver's block after next before the receiver has
+ * finished its current one.
+ */
+#define NUM_SLOTS 2
+
+#define num_chunks(t) \
+    (((t)->num_cols + (t)->chunk - 1) / (t)->chunk)
+
+#define slot_disp(t, s) \
+    ((MPI_Aint)(s) * (t)->num_cols)
+
+#define flag_disp(t, s, off) \
+    ((MPI_Aint)NUM_SLOTS * (t)->num_cols + (MPI_Aint)(s) * num_chunks(t) + (off) / (t)->chunk)
+
+#define slot_of(t, block) \
+    (((block) / (t)->size) % NUM_SLOTS)
+
+static error_t
+rma_init(transport_t *t, size_t num_cols)
+{
+    MPI_Comm node_comm;
+    MPI_Comm_split_type(MPI_COMM_WORLD, MPI_COMM_TYPE_SHARED,
+                        t->rank, MPI_INFO_NULL, &node_comm);
+
+    int node_size = 0;
+    MPI_Comm_size(node_comm, &node_size);
+    MPI_Comm_free(&node_comm);
+
+    t->win = MPI_WIN_NULL;
+    t->num_cols = num_cols;
+    t->shared = node_size == t->size;
+
+    MPI_Aint bytes = NUM_SLOTS * (num_cols + num_chunks(t)) * sizeof(int_t);
+
+    int rc = t->shared
+        ? MPI_Win_allocate_shared(bytes, sizeof(int_t), MPI_INFO_NULL,
+                                  MPI_COMM_WORLD, &t->win_base, &t->win)
+        : MPI_Win_allocate(bytes, sizeof(int_t), MPI_INFO_NULL,
+                           MPI_COMM_WORLD, &t->win_base, &t->win);
+    if (rc != MPI_SUCCESS)
+        return MEM_ERR;
+
+    memset(t->win_base, 0, bytes);
+    MPI_Barrier(MPI_COMM_WORLD);
+    MPI_Win_lock_all(0, t->win);
+
+    return OK;
+}
+
+static void
+rma_send(transport_t *t, const int_t *row,
+         size_t off, size_t cnt, size_t block)
+{
+    const int target = (t->rank + 1) % t->size;
+    const size_t slot = slot_of(t, block + 1);
+    const int_t flag = block + 2;
+
+    MPI_Put(row + off, cnt, MPI_INT_T, target,
+            slot_disp(t, slot) + off, cnt, MPI_INT_T, t->win);
+    MPI_Win_flush(target, t->win);
+
+    MPI_Accumulate(&flag, 1, MPI_INT_T, target,
+                   flag_disp(t, slot, off), 1, MPI_INT_T, MPI_REPLACE, t->win);
+    MPI_Win_flush(target, t->win);
+}
+
+static const int_t *
+rma_recv(transport_t *t, size_t off, size_t cnt, size_t block)
+{
+    (void)cnt;
+
+    const size_t slot = slot_of(t, block);
+    const int_t expected = block + 1;
+
+    int_t flag = 0;
+    loop
+    {
+        MPI_Fetch_and_op(NULL, &flag, MPI_INT_T, t->rank,
+                         flag_disp(t, slot, off), MPI_NO_OP, t->win);
+        MPI_Win_flush(t->rank, t->win);
+        if (flag == expected)
+            break;
+    }
+
+    MPI_Win_sync(t->win);
+    return t->win_base + slot_disp(t, slot);
+}
+
+static void
+rma_flush(transport_t *t)
+{
+    (void)t;
+}
+
+static void
+rma_drop(transport_t *t)
+{
+    if (t->win == MPI_WIN_NULL)
+        return;
+
+    MPI_Win_unlock_all(t->win);
+    MPI_Win_free(&t->win);
+}
+
+static const transport_t
+p2p_transport = {
+    .init  = p2p_init,
+    .send  = p2p_send,
+    .recv  = p2p_recv,
+    .flush = p2p_flush,
+    .drop  = p2p_drop,
+};
+
+static const transport_t
+rma_transport = {
+    .init  = rma_init,
+    .send  = rma_send,
+    .recv  = rma_recv,
+    .flush = rma_flush,
+    .drop  = rma_drop,
+};
+
+static void
+solve_block(const items_t *items, const band_t *band, size_t start, size_t rows,
+            size_t block, size_t num_blocks,
+            int_t *table, uint64_t *keep, transport_t *t, const int_t *local_boundary)
+{
+    const size_t num_cols = t->num_cols;
+    const size_t num_words = bit_words(num_cols);
+
+    for (size_t j = 0; j < num_cols; j += t->chunk)
+    {
+        const size_t cols = min(t->chunk, num_cols - j);
+        const int_t *boundary = local_boundary
+            ? local_boundary
+            : t->recv(t, j, cols, block);
+
+        for (size_t i = 0; i < rows; ++i)
+        {
+            const int_t *prev = i ? table + (i - 1) * num_cols : boundary;
+            int_t *cur = table + i * num_cols;
+            uint64_t *bits = keep + i * num_words;
+
+            const size_t r = start + i + 1;
+            const weight_t w = band_item(band, items, r)->weight;
+            const value_t  v = band_item(band, items, r)->value;
+
+            // Nothing left of the band is ever read, everything below the
+            // weight is a copy and everything above it is a constant.
+            const size_t e = j + cols - 1;
+            const size_t hi = band->hi[r];
+            size_t k = max(j, band->lo[r]);
+            if (k > e)
+                continue;
+
+            const size_t copy_end = min(e + 1, w);
+            if (k < copy_end)
+            {
+                memcpy(cur + k, prev + k, (copy_end - k) * sizeof(int_t));
+                k = copy_end;
+            }
+
+            for (const size_t last = min(e, hi); k <= last; ++k)
+            {
+                cur[k] = prev[k];
+                if (cur[k] < prev[k - w] + v)
+                {
+                    cur[k] = prev[k - w] + v;
+                    set_bit(bits, k);
+                }
+            }
+
+            for (const int_t top = (k <= e) ? cur[hi] : 0; k <= e; ++k)
+            {
+                cur[k] = top;
+                if (v > 0)
+                    set_bit(bits, k);
+            }
+        }
+
+        if (t->size > 1 && block + 1 < num_blocks)
+            t->send(t, table + (rows - 1) * num_cols, j, cols, block);
+    }
+
+    t->flush(t);
+}
+
+#define keep_bit(keep, row, words, k) \
+    test_bit(&(keep)[(row) * (words)], k)
+
+static error_t
+pack_knapsack_mpi_with(knapsack_t *knapsack, double *dt, const items_t *items,
+                       const transport_t *proto, const tune_t *tune)
+{
+    assert(knapsack && items && proto && tune);
+
+    transport_t t = *proto;
+    MPI_Comm_size(MPI_COMM_WORLD, &t.size);
+    MPI_Comm_rank(MPI_COMM_WORLD, &t.rank);
+    t.num_cols = knapsack->max_weight + 1;
+
+    t.chunk = tune->block_cols;
+
+    const size_t block_rows = tune->block_rows;
+    const size_t n = items->count;
+    const size_t num_cols = t.num_cols;
+    const size_t num_words = bit_words(num_cols);
+    const size_t num_blocks = (n + block_rows - 1) / block_rows;
+
+    const size_t num_local_blocks = ((size_t)t.rank < num_blocks)
+        ? (num_blocks - 1 - t.rank) / t.size + 1
+        : 0;
+
+    size_t num_local = 0;
+    for (size_t b = t.rank; b < num_blocks; b += t.size)
+        num_local += min(block_rows, n - b * block_rows);
+
+    band_t band = new(band_t);
+    int_t *table = malloc(block_rows * num_cols * sizeof(int_t));
+    int_t *carry = calloc(num_cols, sizeof(int_t));
+    uint64_t *keep = calloc(num_local * num_words + 1, sizeof(uint64_t));
+    unsigned char *chosen = calloc(n + 1, 1);
+
+    // init is collective for some transports, so every rank has to get
+    // there before anyone bails out.
+    int local_err = t.init(&t, num_cols);
+    if (!table || !carry || !keep || !chosen)
+        local_err = MEM_ERR;
+    if (local_err == OK)
+        local_err = init_band(&band, items, knapsack->max_weight);
+
+    int err = OK;
+    MPI_Allreduce(&local_err, &err, 1, MPI_INT, MPI_MAX, MPI_COMM_WORLD);
+    if (err != OK)
+        goto out;
+
+    MPI_Barrier(MPI_COMM_WORLD);
+    double t1 = MPI_Wtime();
+
+    // A single rank would only be talking to itself, so it carries the
+    // boundary row over locally instead.
+    size_t local_row = 0;
+    for (size_t b = t.rank; b < num_blocks; b += t.size)
+    {
+        const size_t rows = min(block_rows, n - b * block_rows);
+        const int_t *local_boundary = (b == 0 || t.size == 1) ? carry : NULL;
+
+        solve_block(items, &band, b * block_rows, rows, b, num_blocks,
+                    table, keep + local_row * num_words, &t, local_boundary);
+        local_row += rows;
+
+        if (t.size == 1)
+            memcpy(carry, table + (rows - 1) * num_cols, num_cols * sizeof(int_t));
+    }
+
+    // Trace back from the last block, handing the remaining capacity down
+    // to the owner of the previous block.
+    for (size_t lb = num_local_blocks; lb-- > 0;)
+    {
+        const size_t b = t.rank + lb * t.size;
+        const size_t start = b * block_rows;
+        const size_t rows = min(block_rows, n - start);
+        local_row -= rows;
+
+        weight_t w = knapsack->max_weight;
+        if (b + 1 < num_blocks)
+            MPI_Recv(&w, 1, MPI_INT_T, (t.rank + 1) % t.size,
+                     TRACE_TAG, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+
+        for (size_t i = rows; i-- > 0;)
+            if (keep_bit(keep, local_row + i, num_words, w))
+            {
+                chosen[band.order[start + i]] = 1;
+                w -= band_item(&band, items, start + i + 1)->weight;
+            }
+
+        if (b > 0)
+            MPI_Send(&w, 1, MPI_INT_T, (t.rank + t.size - 1) % t.size,
+                     TRACE_TAG, MPI_COMM_WORLD);
+    }
+
+    MPI_Allreduce(MPI_IN_PLACE, chosen, n, MPI_UNSIGNED_CHAR, MPI_MAX, MPI_COMM_WORLD);
+    for (size_t i = n; i-- > 0;)
+        if (chosen[i])
+            add_item_to_knapsack(knapsack, &items->arr[i]);
+
+    *dt = MPI_Wtime() - t1;
+
+out:
+    t.drop(&t);
+    drop_band(&band);
+    free(chosen);
+    free(keep);
+    free(carry);
+    free(table);
+
+    return err;
+}
+
+/*
+ * Capacity decomposition: every rank owns a contiguous range of columns
+ * and keeps a single row of it. Row i of column k needs column k - w of
+ * row i - 1, so before each item the rank pulls a halo of up to w cells
+ * from the lower-capacity ranks. Consecutive light items are batched: with
+ * a halo as wide as their total weight, the whole batch can be computed
+ * locally, and only the cells right of the halo come out exact.
+ */
+#define HALO_DIV 4
+
+#define part_lo(r, size, num_cols) \
+    ((size_t)(((unsigned __int128)(r) * (num_cols)) / (size)))
+
+static int
+part_owner(size_t k, int size, size_t num_cols)
+{
+    int r = (int)(((unsigned __int128)k * size) / num_cols);
+    while (r + 1 < size && part_lo(r + 1, size, num_cols) <= k)
+        ++r;
+    while (r > 0 && part_lo(r, size, num_cols) > k)
+        --r;
+    return r;
+}
+
+// ext holds columns from origin onwards: the halo and then the own part.
+static void
+exchange_halo(int_t *ext, size_t origin, size_t lo, size_t hi, size_t halo,
+              int rank, int size, size_t num_cols, MPI_Request *reqs)
+{
+    int num_reqs = 0;
+
+    for (int r = rank + 1; r < size; ++r)
+    {
+        const size_t r_lo = part_lo(r, size, num_cols);
+        const size_t a = (r_lo > halo) ? r_lo - halo : 0;
+        if (a >= hi)
+            break;
+
+        const size_t b = min(hi, r_lo);
+        const size_t from = (a > lo) ? a : lo;
+        if (from < b)
+            MPI_Isend(ext + (from - origin), b - from, MPI_INT_T, r,
+                      HALO_TAG, MPI_COMM_WORLD, &reqs[num_reqs++]);
+    }
+
+    const size_t need = (lo > halo) ? lo - halo : 0;
+    for (int r = rank - 1; r >= 0; --r)
+    {
+        const size_t r_lo = part_lo(r, size, num_cols);
+        const size_t r_hi = part_lo(r + 1, size, num_cols);
+        if (r_hi <= need)
+            break;
+
+        const size_t from = (r_lo > need) ? r_lo : need;
+        if (from < r_hi)
+            MPI_Irecv(ext + (from - origin), r_hi - from, MPI_INT_T, r,
+                      HALO_TAG, MPI_COMM_WORLD, &reqs[num_reqs++]);
+    }
+
+    MPI_Waitall(num_reqs, reqs, MPI_STATUSES_IGNORE);
+}
+
+error_t
+pack_knapsack_mpi_cols(knapsack_t *knapsack, double *dt, const items_t *items)
+{
+    assert(knapsack && items);
+
+    int size, rank;
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    const size_t n = items->count;
+    const size_t num_cols = knapsack->max_weight + 1;
+    const size_t lo = part_lo(rank, size, num_cols);
+    const size_t hi = part_lo(rank + 1, size, num_cols);
+    const size_t width = hi - lo;
+    const size_t num_words = bit_words(width);
+
+    size_t batch_halo = num_cols / size / HALO_DIV;
+    weight_t max_w = 0;
+    for (size_t i = 0; i < n; ++i)
+        if (items->arr[i].weight > max_w)
+            max_w = items->arr[i].weight;
+
+    const size_t halo_max = min(lo, (max_w > batch_halo) ? max_w : batch_halo);
+
+    band_t band = new(band_t);
+    int_t *ext = calloc(halo_max + width + 1, sizeof(int_t));
+    uint64_t *keep = calloc(n * num_words + 1, sizeof(uint64_t));
+    unsigned char *chosen = calloc(n + 1, 1);
+    MPI_Request *reqs = malloc(2 * size * sizeof(MPI_Request));
+
+    int local_err = (!ext || !keep || !chosen || !reqs) ? MEM_ERR : OK;
+    if (local_err == OK)
+        local_err = init_band(&band, items, knapsack->max_weight);
+    int err = OK;
+    MPI_Allreduce(&local_err, &err, 1, MPI_INT, MPI_MAX, MPI_COMM_WORLD);
+    if (err != OK)
+        goto out;
+
+    const size_t origin = lo - halo_max;
+
+    MPI_Barrier(MPI_COMM_WORLD);
+    double t1 = MPI_Wtime();
+
+    for (size_t i = 0, e = 0; i < n; i = e)
+    {
+        // Every rank sees the same weights, so they all agree on the batch.
+        size_t halo = band_item(&band, items, i + 1)->weight;
+        for (e = i + 1; e < n && halo + band_item(&band, items, e + 1)->weight <= batch_halo; ++e)
+            halo += band_item(&band, items, e + 1)->weight;
+
+        exchange_halo(ext, origin, lo, hi, halo, rank, size, num_cols, reqs);
+
+        const size_t base = lo - min(lo, halo);
+        for (size_t j = i; j < e; ++j)
+        {
+            const weight_t w = band_item(&band, items, j + 1)->weight;
+            const value_t  v = band_item(&band, items, j + 1)->value;
+            uint64_t *bits = keep + j * num_words;
+
+            // Above the band every column already holds the sum of all
+            // values so far and simply gains this one; below it nothing is
+            // ever read again.
+            const size_t top = band.hi[j + 1];
+            const size_t from = max(base + w, band.lo[j + 1]);
+
+            for (size_t c = hi; c-- > max(top + 1, base);)
+            {
+                ext[c - origin] += v;
+                if (c >= lo && v > 0)
+                    set_bit(bits, c - lo);
+            }
+
+            for (size_t c = min(hi, top + 1); c-- > from;)
+                if (ext[c - w - origin] + v > ext[c - origin])
+                {
+                    ext[c - origin] = ext[c - w - origin] + v;
+                    if (c >= lo)
+                        set_bit(bits, c - lo);
+                }
+        }
+    }
+
+    // The trace back follows the remaining capacity, so it is handed over
+    // to whichever rank owns that column until no items are left.
+    int_t token[2] = { n, knapsack->max_weight };
+    int have = part_owner(token[1], size, num_cols) == rank;
+    loop
+    {
+        if (!have)
+        {
+            MPI_Recv(token, 2, MPI_INT_T, MPI_ANY_SOURCE,
+                     TRACE_TAG, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+            if (token[0] == 0)
+                break;
+        }
+
+        while (token[0] > 0 && part_owner(token[1], size, num_cols) == rank)
+        {
+            const size_t j = --token[0];
+            const size_t k = token[1] - lo;
+            if (test_bit(&keep[j * num_words], k))
+            {
+                chosen[band.order[j]] = 1;
+                token[1] -= band_item(&band, items, j + 1)->weight;
+            }
+        }
+
+        if (token[0] == 0)
+        {
+            for (int r = 0; r < size; ++r)
+                if (r != rank)
+                    MPI_Send(token, 2, MPI_INT_T, r, TRACE_TAG, MPI_COMM_WORLD);
+            break;
+        }
+
+        MPI_Send(token, 2, MPI_INT_T, part_owner(token[1], size, num_cols),
+                 TRACE_TAG, MPI_COMM_WORLD);
+        have = 0;
+    }
+
+    MPI_Allreduce(MPI_IN_PLACE, chosen, n, MPI_UNSIGNED_CHAR, MPI_MAX, MPI_COMM_WORLD);
+    for (size_t i = n; i-- > 0;)
+        if (chosen[i])
+            add_item_to_knapsack(knapsack, &items->arr[i]);
+
+    *dt = MPI_Wtime() - t1;
+
+out:
+    drop_band(&band);
+    free(reqs);
+    free(chosen);
+    free(keep);
+    free(ext);
+
+    return err;
+}
+
+/*
+ * The pipeline keeps every rank busy only when there are many more blocks
+ * than ranks; with few items its fill and drain dominate. Split the
+ * capacity instead when there are few blocks per rank and every rank still
+ * gets at least a chunk worth of columns.
+ */
+#define PIPELINE_MIN_BLOCKS_PER_RANK 4
+
+static int
+prefer_capacity_split(size_t n, size_t num_cols, int size, const tune_t *tune)
+{
+    if (size == 1)
+        return 0;
+
+    const size_t num_blocks = (n + tune->block_rows - 1) / tune->block_rows;
+    return num_blocks < PIPELINE_MIN_BLOCKS_PER_RANK * (size_t)size &&
+           num_cols / size >= tune->block_cols;
+}
+
+error_t
+pack_knapsack_mpi(knapsack_t *knapsack, double *dt, const items_t *items)
+{
+    int size = 1;
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+
+    tune_t tune;
+    find_tune_mpi(&tune, knapsack->tunes, knapsack->max_weight, items->count);
+
+    if (prefer_capacity_split(items->count, knapsack->max_weight + 1, size, &tune))
+        return pack_knapsack_mpi_cols(knapsack, dt, items);
+
+    return pack_knapsack_mpi_with(knapsack, dt, items, &p2p_transport, &tune);
+}
+
+error_t
+pack_knapsack_mpi_pipeline(knapsack_t *knapsack, double *dt, const items_t *items)
+{
+    tune_t tune;
+    find_tune_mpi(&tune, knapsack->tunes, knapsack->max_weight, items->count);
+
+    return pack_knapsack_mpi_with(knapsack, dt, items, &p2p_transport, &tune);
+}
+
+error_t
+pack_knapsack_mpi_rma(knapsack_t *knapsack, double *dt, const items_t *items)
+{
+    tune_t tune;
+    find_tune_mpi(&tune, knapsack->tunes, knapsack->max_weight, items->count);
+
+    return pack_knapsack_mpi_with(knapsack, dt, items, &rma_transport, &tune);
+}
+
+int
+mpi_world(int *rank, int *size)
+{
+    int initialized = 0, finalized = 0;
+    MPI_Initialized(&initialized);
+    MPI_Finalized(&finalized);
+
+    *rank = 0;
+    *size = 1;
+    if (!initialized || finalized)
+        return 0;
+
+    MPI_Comm_rank(MPI_COMM_WORLD, rank);
+    MPI_Comm_size(MPI_COMM_WORLD, size);
+    return 1;
+}
+
+// MPI counts are ints, so big buffers go out in pieces.
+#define BCAST_CHUNK ((size_t)1 << 30)
+
+static void
+bcast_bytes(void *buf, size_t len)
+{
+    for (size_t off = 0; off < len; off += BCAST_CHUNK)
+        MPI_Bcast((char *)buf + off, (int)min(BCAST_CHUNK, len - off),
+                  MPI_BYTE, 0, MPI_COMM_WORLD);
+}
+
+/*
+ * Every engine needs the whole item list (the band is computed from it and
+ * the trace back walks all of it), so the items are broadcast rather than
+ * scattered. What this saves is P - 1 parsers and file readers: one pass
+ * over the text on rank 0, one binary broadcast for everybody else.
+ */
+error_t
+read_knapsack_mpi(FILE *f, knapsack_t *knapsack, items_t *items)
+{
+    assert(knapsack && items);
+
+    int rank, size;
+    const int mpi = mpi_world(&rank, &size);
+
+    error_t err = OK;
+    if (rank == 0)
+    {
+        err = f ? read_knapsack_info(f, knapsack) : ARG_ERR;
+        if (err == OK)
+            err = read_items_info(f, items);
+    }
+
+    if (!mpi)
+        return err;
+
+    MPI_Bcast(&err, 1, MPI_INT, 0, MPI_COMM_WORLD);
+    if (err != OK)
+        return err;
+
+    uint64_t head[2] = { knapsack->max_weight, items->count };
+    MPI_Bcast(head, 2, MPI_UINT64_T, 0, MPI_COMM_WORLD);
+
+    if (rank != 0)
+    {
+        knapsack->max_weight = head[0];
+
+        item_t *arr = realloc(items->arr, max(head[1], 1) * sizeof(item_t));
+        if (arr)
+        {
+            items->arr = arr;
+            items->count = items->capacity = head[1];
+        }
+        else
+            err = MEM_ERR;
+    }
+
+    MPI_Allreduce(MPI_IN_PLACE, &err, 1, MPI_INT, MPI_MAX, MPI_COMM_WORLD);
+    if (err != OK)
+        return err;
+
+    bcast_bytes(items->arr, items->count * sizeof(item_t));
+
+    return OK;
+}
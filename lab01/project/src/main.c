@@ -7,9 +7,22 @@
 
 #include <macro.h>
 #include <knapsack.h>
+#include <solver.h>
+#include <tune.h>
+#include <plan.h>
+#include <profile.h>
 
 #define OMP_FLAG "--omp"
+#define STREAM_FLAG "--stream"
+#define AUTOTUNE_FLAG "--autotune"
+#define AUTO_FLAG "--auto"
+#define UNBOUNDED_FLAG "--unbounded"
+#define UNBOUNDED_OMP_FLAG "--unbounded-omp"
+#define MITM_FLAG "--mitm"
+#define PROFILE_FLAG "--profile"
+#define PROFILE_BREAKPOINTS_FLAG "--profile-breakpoints"
 #define MPI_FLAG "--mpi"
+#define MPI_RMA_FLAG "--mpi-rma"
 
 #define TEST_FLAG "--test"
 
@@ -20,8 +33,26 @@
     (strcmp((mode), (tested)) == 0)
 #define IS_OMP(mode) \
     __check_mode__(mode, OMP_FLAG)
+#define IS_MPI_RMA(mode) \
+    __check_mode__(mode, MPI_RMA_FLAG)
 #define IS_MPI(mode) \
-    __check_mode__(mode, MPI_FLAG)
+    (__check_mode__(mode, MPI_FLAG) || IS_MPI_RMA(mode))
+#define IS_STREAM(mode) \
+    __check_mode__(mode, STREAM_FLAG)
+#define IS_AUTOTUNE(mode) \
+    __check_mode__(mode, AUTOTUNE_FLAG)
+#define IS_AUTO(mode) \
+    __check_mode__(mode, AUTO_FLAG)
+#define IS_UNBOUNDED(mode) \
+    __check_mode__(mode, UNBOUNDED_FLAG)
+#define IS_UNBOUNDED_OMP(mode) \
+    __check_mode__(mode, UNBOUNDED_OMP_FLAG)
+#define IS_MITM(mode) \
+    __check_mode__(mode, MITM_FLAG)
+#define IS_PROFILE_BREAKPOINTS(mode) \
+    __check_mode__(mode, PROFILE_BREAKPOINTS_FLAG)
+#define IS_PROFILE(mode) \
+    (__check_mode__(mode, PROFILE_FLAG) || IS_PROFILE_BREAKPOINTS(mode))
 #define IS_TEST(mode) \
     __check_mode__(mode, TEST_FLAG)
 
@@ -31,6 +62,17 @@ do_task(int argc, char *argv[]);
 int
 do_test(int argc, char *argv[]);
 
+static error_t
+do_profile(FILE *f, const solver_t *solver, const char *mode,
+           int num_caps, char *caps[]);
+
+// The library stays quiet, the CLI shows its plans.
+static error_t
+pack_knapsack_auto_stdout(knapsack_t *knapsack, double *dt, const items_t *items)
+{
+    return pack_knapsack_auto(knapsack, dt, items, stdout);
+}
+
 int
 main(int argc, char *argv[])
 {
@@ -45,7 +87,8 @@ main(int argc, char *argv[])
     }
     else
     {
-        if (argc != TASK_NUM_ARGS)
+        // Profiles may be followed by capacities to trace back.
+        if (argc != TASK_NUM_ARGS && !(IS_PROFILE(mode) && argc > TASK_NUM_ARGS))
             goto usage;
     }
 
@@ -55,14 +98,14 @@ main(int argc, char *argv[])
 
 usage:
     puts("Usage:");
-    printf("%s [--mpi|--omp] source destination\n", argv[0]);
+    printf("%s [--auto|--mpi|--mpi-rma|--omp|--stream|--unbounded|--unbounded-omp|--mitm] source destination\n", argv[0]);
+    printf("%s --autotune source cache\n", argv[0]);
+    printf("%s [--profile|--profile-breakpoints] source destination [capacity...]\n", argv[0]);
     printf("%s --test nmin nmax nstep wmin wmax wstep vimin vimax wimin wimax\n", argv[0]);
 
     return 1;
 }
 
-typedef error_t (*pack_func_t)(knapsack_t *, double *, const items_t *);
-
 int
 do_task(int argc, char *argv[])
 {
@@ -70,60 +113,121 @@ do_task(int argc, char *argv[])
     const char *src_path = argv[2];
     const char *dst_path = argv[3];
 
-    if (IS_MPI(mode))
+    const int distributed = IS_MPI(mode) || IS_AUTOTUNE(mode) || IS_AUTO(mode);
+
+    int rank = 0;
+    if (distributed)
+    {
         MPI_Init(&argc, &argv);
+        MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    }
+
+    // Only rank 0 touches the files, the others get the task over MPI.
+    // Autotune writes its cache itself, by rank 0 and through a rename.
+    FILE *src_file = NULL, *dst_file = NULL;
+    if (rank == 0)
+    {
+        src_file = fopen(src_path, "r");
+        dst_file = IS_AUTOTUNE(mode) ? stdout : fopen(dst_path, "w");
+    }
 
-    FILE *src_file = fopen(src_path, "r");
-    FILE *dst_file = fopen(dst_path, "w");
+    solver_t *solver = create_solver();
 
-    items_t items = new(items_t);
-    knapsack_t knapsack = new(knapsack_t);
+    // Every rank has to agree before any of them bails out.
+    error_t err = !solver ? MEM_ERR
+        : (rank != 0 || (src_file && dst_file)) ? OK : ARG_ERR;
 
-    error_t err = OK;
-    if (!src_file || !dst_file)
+    // The tuning cache is read once, by rank 0 as well: the MPI engines
+    // use its answer on every rank.
+    if (err == OK && rank == 0 && !IS_AUTOTUNE(mode))
+        err = solver_load_tune(solver, NULL);
+    if (distributed)
+        MPI_Allreduce(MPI_IN_PLACE, &err, 1, MPI_INT, MPI_MAX, MPI_COMM_WORLD);
+    if (err != OK)
+        goto out;
+
+    if (IS_STREAM(mode))
     {
-        err = ARG_ERR;
+        err = solver_stream(solver, src_file, dst_file);
+        if (err == OK)
+            printf("Task complete. Duration = %lf\n", solver_duration(solver));
         goto out;
     }
 
-    err = init_items(&items);
+    err = distributed
+        ? solver_read_mpi(solver, src_file)
+        : solver_read(solver, src_file);
     if (err != OK)
         goto out;
 
-    err = init_knapsack(&knapsack);
-    if (err != OK)
-        goto out;
+    const weight_t max_weight = solver_max_weight(solver);
+    const items_t *items = solver_items(solver);
 
-    err = read_knapsack_info(src_file, &knapsack);
-    if (err != OK)
+    if (IS_AUTOTUNE(mode))
+    {
+        tune_t tune;
+        err = autotune_knapsack(&tune, max_weight, items, stdout);
+        if (err != OK)
+            goto out;
+
+        if (rank == 0)
+        {
+            printf("Tuned: threads=%d rows=%lu cols=%lu\n",
+                   tune.num_threads, tune.block_rows, tune.block_cols);
+            err = save_tune(dst_path, &tune, max_weight, items->count);
+        }
         goto out;
+    }
 
-    err = read_items_info(src_file, &items);
-    if (err != OK)
+    if (IS_PROFILE(mode))
+    {
+        err = do_profile(dst_file, solver, mode,
+                         argc - TASK_NUM_ARGS, argv + TASK_NUM_ARGS);
         goto out;
+    }
 
-    double dt = 0;
     pack_func_t pack_knapsack_func = pack_knapsack;
 
     if (IS_OMP(mode))
         pack_knapsack_func = pack_knapsack_omp;
+    elif (IS_UNBOUNDED(mode))
+        pack_knapsack_func = pack_knapsack_unbounded;
+    elif (IS_UNBOUNDED_OMP(mode))
+        pack_knapsack_func = pack_knapsack_unbounded_omp;
+    elif (IS_MITM(mode))
+        pack_knapsack_func = pack_knapsack_mitm;
+    elif (IS_AUTO(mode))
+        pack_knapsack_func = pack_knapsack_auto_stdout;
+    elif (IS_MPI_RMA(mode))
+        pack_knapsack_func = pack_knapsack_mpi_rma;
     elif (IS_MPI(mode))
         pack_knapsack_func = pack_knapsack_mpi;
 
-    err = pack_knapsack_func(&knapsack, &dt, &items);
+    // Subset-sum instances need a bit per cell, not a value.
+    if (pack_knapsack_func == pack_knapsack && is_subset_sum(items))
+        pack_knapsack_func = pack_knapsack_subset;
+    elif (pack_knapsack_func == pack_knapsack_omp && is_subset_sum(items))
+        pack_knapsack_func = pack_knapsack_subset_omp;
+
+    err = solver_solve(solver, pack_knapsack_func);
     if (err != OK)
         goto out;
 
-    printf("Task complete. Duration = %lf\n", dt);
-    err = write_knapsack_info(dst_file, &knapsack);
+    if (rank == 0)
+    {
+        printf("Task complete. Duration = %lf\n", solver_duration(solver));
+        err = solver_write(solver, dst_file);
+    }
 
 out:
-    drop_knapsack(&knapsack);
-    drop_items(&items);
+    destroy_solver(solver);
 
-    dst_file ? fclose(dst_file):0;
+    (dst_file && dst_file != stdout) ? fclose(dst_file):0;
     src_file ? fclose(src_file):0;
 
+    if (distributed)
+        MPI_Finalize();
+
     if (err != OK)
         return ERR_TO_RET_CODE(err);
 
@@ -157,12 +261,17 @@ do_test(int argc, char *argv[])
     parse_args_int_t_bounds(item_value, 8);
     parse_args_int_t_bounds(item_weight, 10);
 
+    tune_cache_t tunes;
+    if ((err = load_tune_cache(&tunes, NULL)) != OK)
+        return ERR_TO_RET_CODE(err);
+
     for (int_t w = max_weight_min; w <= max_weight_max; w += max_weight_step)
     {
         for (size_t n = num_items_min; n <= num_items_max; n += num_items_step)
         {
-            double ts = 0, to = 0;
-            for (size_t j = 1; j <= 2; ++j)
+            double ts = 0, to = 0, tm = 0;
+            int timed_mitm = 0;
+            for (size_t j = 1; j <= 3; ++j)
             {
                 items_t items = new(items_t);
                 knapsack_t knapsack = new(knapsack_t);
@@ -173,6 +282,7 @@ do_test(int argc, char *argv[])
                     goto out;
 
                 knapsack.max_weight = w;
+                knapsack.tunes = &tunes;
                 err = add_random_items_to_items(&items, n,
                                                 item_value_min, item_value_max,
                                                 item_weight_min, item_weight_max);
@@ -194,8 +304,17 @@ do_test(int argc, char *argv[])
                         pack_func = pack_knapsack_omp;
                         break;
 
+                    // Meet in the middle only takes so many items.
+                    case 3:
+                        if (mitm_items(&items, w) > MITM_MAX_ITEMS)
+                            goto out;
+                        timed_mitm = 1;
+                        dp = &tm;
+                        pack_func = pack_knapsack_mitm;
+                        break;
+
                     default:
-                        //TODO handle
+                        err = ARG_ERR;
                         goto out;
                 }
 
@@ -206,12 +325,57 @@ do_test(int argc, char *argv[])
                 drop_knapsack(&knapsack);
 
                 if (err != OK)
+                {
+                    drop_tune_cache(&tunes);
                     return ERR_TO_RET_CODE(err);
+                }
             }
 
-            printf("%lu %lf %lf\n", w, ts, to);
+            if (timed_mitm)
+                printf("%lu %lf %lf %lf\n", w, ts, to, tm);
+            else
+                printf("%lu %lf %lf -\n", w, ts, to);
         }
     }
 
+    drop_tune_cache(&tunes);
     return 0;
 }
+
+/*
+ * The profile first, then for every requested capacity a line with it and
+ * the item set in the usual output format, all from one solve.
+ */
+static error_t
+do_profile(FILE *f, const solver_t *solver, const char *mode,
+           int num_caps, char *caps[])
+{
+    const items_t *items = solver_items(solver);
+
+    profile_t profile;
+    double dt = 0;
+
+    error_t err = solve_profile(&profile, &dt, items, solver_max_weight(solver),
+                                solver_tunes(solver));
+    if (err != OK)
+        return err;
+
+    printf("Task complete. Duration = %lf\n", dt);
+    err = write_profile(f, &profile, IS_PROFILE_BREAKPOINTS(mode));
+
+    for (int i = 0; err == OK && i < num_caps; ++i)
+    {
+        knapsack_t knapsack = new(knapsack_t);
+        err = init_knapsack(&knapsack);
+        if (err == OK)
+            err = trace_profile(&knapsack, &profile, items, parse_int_t(caps[i]));
+        if (err == OK)
+            err = fprintf(f, "%s\n", caps[i]) < 1 ? FIO_ERR : OK;
+        if (err == OK)
+            err = write_knapsack_info(f, &knapsack);
+        drop_knapsack(&knapsack);
+    }
+
+    drop_profile(&profile);
+    return err;
+}
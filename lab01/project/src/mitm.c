@@ -0,0 +1,270 @@
+#include <assert.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+#include <omp.h>
+
+#include <macro.h>
+#include <knapsack.h>
+#include <tune.h>
+
+// Enumerating or merging less than this is not worth a parallel region.
+#define OMP_MIN_COMBOS 4096
+
+typedef struct
+{
+    weight_t weight;
+    value_t  value;
+    uint32_t mask;
+} combo_t;
+
+/*
+ * All 2^k subsets of k items, built by doubling: the second half of every
+ * round is the first one with the next item added. Bit j of mask stands
+ * for items[idx[j]].
+ */
+static void
+enumerate_half(combo_t *out, const items_t *items, const size_t *idx, size_t k,
+               int num_threads)
+{
+    out[0] = (combo_t){ 0, 0, 0 };
+
+    for (size_t j = 0, size = 1; j < k; ++j, size *= 2)
+    {
+        const item_t *item = &items->arr[idx[j]];
+
+        #pragma omp parallel for num_threads(num_threads) if(size >= OMP_MIN_COMBOS)
+        for (size_t m = 0; m < size; ++m)
+        {
+            out[size + m].weight = sat_add(out[m].weight, item->weight);
+            out[size + m].value  = out[m].value + item->value;
+            out[size + m].mask   = out[m].mask | (uint32_t)1 << j;
+        }
+    }
+}
+
+// By weight, the more valuable first among equal weights.
+static int
+cmp_combos(const void *pa, const void *pb)
+{
+    const combo_t *a = pa, *b = pb;
+
+    if (a->weight != b->weight)
+        return (a->weight < b->weight) ? -1 : 1;
+    if (a->value != b->value)
+        return (a->value > b->value) ? -1 : 1;
+    return 0;
+}
+
+static void
+merge_combos(combo_t *dst, const combo_t *a, size_t na, const combo_t *b, size_t nb)
+{
+    size_t i = 0, j = 0, k = 0;
+    while (i < na && j < nb)
+        dst[k++] = (cmp_combos(&b[j], &a[i]) < 0) ? b[j++] : a[i++];
+    while (i < na)
+        dst[k++] = a[i++];
+    while (j < nb)
+        dst[k++] = b[j++];
+}
+
+/*
+ * Every thread sorts one run, then runs are merged pairwise, in parallel
+ * within a round. Returns whichever of a and tmp ends up sorted.
+ */
+static combo_t *
+sort_combos(combo_t *a, combo_t *tmp, size_t count, int num_threads)
+{
+    if (count < OMP_MIN_COMBOS)
+        num_threads = 1;
+
+    const size_t run = (count + num_threads - 1) / num_threads;
+
+    #pragma omp parallel for num_threads(num_threads) schedule(static, 1)
+    for (int t = 0; t < num_threads; ++t)
+    {
+        const size_t lo = min(count, t * run);
+        const size_t hi = min(count, lo + run);
+        qsort(&a[lo], hi - lo, sizeof(combo_t), cmp_combos);
+    }
+
+    for (size_t width = run; width < count; width *= 2)
+    {
+        const size_t pairs = (count + 2 * width - 1) / (2 * width);
+
+        #pragma omp parallel for num_threads(num_threads) if(pairs > 1)
+        for (size_t p = 0; p < pairs; ++p)
+        {
+            const size_t lo = p * 2 * width;
+            const size_t mid = min(count, lo + width);
+            const size_t hi = min(count, mid + width);
+            merge_combos(&tmp[lo], &a[lo], mid - lo, &a[mid], hi - mid);
+        }
+
+        combo_t *swap = a;
+        a = tmp;
+        tmp = swap;
+    }
+
+    return a;
+}
+
+// Drops every subset that some lighter (or as heavy) one beats on value.
+static size_t
+pareto_front(combo_t *a, size_t count)
+{
+    size_t kept = 0;
+    for (size_t i = 0; i < count; ++i)
+        if (kept == 0 || a[i].value > a[kept - 1].value)
+            a[kept++] = a[i];
+    return kept;
+}
+
+// Index of the heaviest entry of the front not heavier than cap.
+static size_t
+find_fitting(const combo_t *front, size_t count, weight_t cap)
+{
+    size_t lo = 0, hi = count;
+    while (hi - lo > 1)
+    {
+        const size_t mid = lo + (hi - lo) / 2;
+        if (front[mid].weight <= cap)
+            lo = mid;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+static void
+take_mask(unsigned char *chosen, const size_t *idx, uint32_t mask)
+{
+    for (size_t j = 0; mask; ++j, mask >>= 1)
+        if (mask & 1)
+            chosen[idx[j]] = 1;
+}
+
+/*
+ * Meet in the middle: the items are split into halves A and B, all subsets
+ * of both are enumerated, B is sorted by weight and reduced to its Pareto
+ * front, and every subset of A is completed by the best fitting front
+ * entry, found by binary search. O(2^(n/2) n) time and memory, whatever
+ * the capacity.
+ */
+size_t
+mitm_items(const items_t *items, weight_t max_weight)
+{
+    size_t n = 0;
+    for (size_t i = 0; i < items->count; ++i)
+        if (items->arr[i].weight <= max_weight)
+            ++n;
+    return n;
+}
+
+static error_t
+pack_mitm_with(knapsack_t *knapsack, double *dt, const items_t *items,
+               int num_threads)
+{
+    assert(knapsack && items);
+
+    const weight_t max_weight = knapsack->max_weight;
+
+    double t1 = omp_get_wtime();
+
+    // Items heavier than the knapsack never make it in, leave them out.
+    size_t *idx = malloc((items->count + 1) * sizeof(size_t));
+    if (!idx)
+        return MEM_ERR;
+
+    size_t n = 0;
+    for (size_t i = 0; i < items->count; ++i)
+        if (items->arr[i].weight <= max_weight)
+            idx[n++] = i;
+
+    if (n > MITM_MAX_ITEMS)
+    {
+        free(idx);
+        return ARG_ERR;
+    }
+
+    const size_t ka = n / 2, kb = n - ka;
+    const size_t na = (size_t)1 << ka, nb = (size_t)1 << kb;
+
+    combo_t *a = malloc(na * sizeof(combo_t));
+    combo_t *b = malloc(nb * sizeof(combo_t));
+    combo_t *tmp = malloc(nb * sizeof(combo_t));
+    unsigned char *chosen = calloc(items->count + 1, 1);
+
+    error_t err = OK;
+    if (!a || !b || !tmp || !chosen)
+    {
+        err = MEM_ERR;
+        goto out;
+    }
+
+    enumerate_half(a, items, idx, ka, num_threads);
+    enumerate_half(b, items, idx + ka, kb, num_threads);
+
+    const combo_t *front = sort_combos(b, tmp, nb, num_threads);
+    const size_t nf = pareto_front((combo_t *)front, nb);
+
+    value_t best_value = 0;
+    size_t best_a = 0, best_b = 0;
+
+    #pragma omp parallel num_threads(num_threads) if(na >= OMP_MIN_COMBOS)
+    {
+        value_t value = 0;
+        size_t ia = 0, ib = 0;
+
+        #pragma omp for schedule(static) nowait
+        for (size_t i = 0; i < na; ++i)
+        {
+            if (a[i].weight > max_weight)
+                continue;
+
+            const size_t j = find_fitting(front, nf, max_weight - a[i].weight);
+            if (a[i].value + front[j].value > value)
+            {
+                value = a[i].value + front[j].value;
+                ia = i;
+                ib = j;
+            }
+        }
+
+        // Ties go to the first subset of A, whatever the thread count.
+        #pragma omp critical (mitm_best)
+        if (value > best_value || (value == best_value && value && ia < best_a))
+        {
+            best_value = value;
+            best_a = ia;
+            best_b = ib;
+        }
+    }
+
+    take_mask(chosen, idx, a[best_a].mask);
+    take_mask(chosen, idx + ka, front[best_b].mask);
+
+    for (size_t i = items->count; err == OK && i > 0; --i)
+        if (chosen[i - 1])
+            err = add_item_to_knapsack(knapsack, &items->arr[i - 1]);
+
+out:
+    *dt = omp_get_wtime() - t1;
+
+    free(chosen);
+    free(tmp);
+    free(b);
+    free(a);
+    free(idx);
+
+    return err;
+}
+
+error_t
+pack_knapsack_mitm(knapsack_t *knapsack, double *dt, const items_t *items)
+{
+    tune_t tune;
+    find_tune(&tune, knapsack->tunes, knapsack->max_weight, items->count);
+
+    return pack_mitm_with(knapsack, dt, items, tune.num_threads);
+}
@@ -0,0 +1,356 @@
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <omp.h>
+#include <mpi.h>
+
+#include <macro.h>
+#include <plan.h>
+#include <band.h>
+#include <tune.h>
+
+// Cost model, in seconds.
+#define CELL_COST     1.0e-9
+#define ROW_SYNC_COST 1.0e-6
+#define MSG_COST      5.0e-6
+#define BYTE_COST     1.0e-10
+
+// Leave some headroom for the allocator, the input and everything else.
+#define RAM_USABLE 0.8
+
+#define MIB (1024.0 * 1024.0)
+
+typedef struct
+{
+    size_t   n;
+    size_t   fitting;
+    weight_t max_weight;
+    weight_t total_weight;
+    value_t  total_value;
+
+    double cells;
+    double ram;
+    int cores;
+    int ranks;
+    int node_ranks;
+    int subset;
+
+    tune_t tune;
+} shape_t;
+
+static double
+available_ram(void)
+{
+    FILE *f = fopen("/proc/meminfo", "r");
+    if (f)
+    {
+        char line[128];
+        unsigned long kb = 0;
+        while (fgets(line, sizeof(line), f))
+            if (sscanf(line, "MemAvailable: %lu kB", &kb) == 1)
+                break;
+        fclose(f);
+
+        if (kb)
+            return kb * 1024.0;
+    }
+
+    return (double)sysconf(_SC_AVPHYS_PAGES) * sysconf(_SC_PAGESIZE);
+}
+
+static error_t
+pack_knapsack_all(knapsack_t *knapsack, double *dt, const items_t *items)
+{
+    double t1 = omp_get_wtime();
+
+    error_t err = OK;
+    for (size_t i = items->count; err == OK && i > 0; --i)
+        err = add_item_to_knapsack(knapsack, &items->arr[i - 1]);
+
+    *dt = omp_get_wtime() - t1;
+    return err;
+}
+
+static error_t
+pack_knapsack_none(knapsack_t *knapsack, double *dt, const items_t *items)
+{
+    (void)knapsack;
+    (void)items;
+
+    *dt = 0;
+    return OK;
+}
+
+typedef void (*estimate_func_t)(plan_t *, const shape_t *);
+
+// More threads than cores only add overhead.
+static double
+num_threads(const shape_t *s)
+{
+    return min(s->tune.num_threads, s->cores);
+}
+
+static void
+estimate_trivial(plan_t *plan, const shape_t *s)
+{
+    plan->time = s->n * CELL_COST;
+    plan->memory = 0;
+}
+
+static void
+estimate_seq(plan_t *plan, const shape_t *s)
+{
+    plan->time = s->cells * CELL_COST;
+    plan->memory = s->cells * sizeof(int_t) + (s->n + 1) * sizeof(int_t *);
+}
+
+static void
+estimate_omp(plan_t *plan, const shape_t *s)
+{
+    estimate_seq(plan, s);
+    plan->time = s->cells * CELL_COST / num_threads(s) +
+                 s->n * ROW_SYNC_COST;
+}
+
+static void
+estimate_subset(plan_t *plan, const shape_t *s)
+{
+    const double words = s->max_weight / 64.0 + 1;
+
+    plan->time = s->n * words * CELL_COST / num_threads(s) +
+                 s->n * ROW_SYNC_COST;
+    plan->memory = 2 * (sqrt(s->n) + 2) * words * sizeof(uint64_t);
+}
+
+static void
+estimate_mitm(plan_t *plan, const shape_t *s)
+{
+    const double half = ldexp(1, (int)(s->fitting - s->fitting / 2));
+
+    // Enumerating and sorting one half, a binary search per subset of the other.
+    plan->time = 2 * half * s->fitting * CELL_COST / num_threads(s);
+    // Both halves and a sort buffer of (weight, value, padded mask).
+    plan->memory = 3 * half * 3 * sizeof(int_t);
+}
+
+static void
+estimate_mpi_pipeline(plan_t *plan, const shape_t *s)
+{
+    const double cols = s->max_weight + 1.0;
+    const double rows = s->tune.block_rows;
+    const double blocks = (s->n + rows - 1) / rows;
+    const double chunks = cols / s->tune.block_cols;
+
+    // Every rank after the first waits one block before it can start.
+    const double per_block = s->cells / (blocks ? blocks : 1);
+    plan->time = s->cells * CELL_COST / s->ranks +
+                 (s->ranks - 1) * per_block * CELL_COST +
+                 blocks * chunks * MSG_COST / s->ranks;
+
+    // A block of rows, the carry and boundary rows, and the keep bits of
+    // the rank's own share of the blocks.
+    plan->memory = rows * cols * sizeof(int_t) + 2 * cols * sizeof(int_t) +
+                   s->n * cols / 8 / s->ranks;
+}
+
+static void
+estimate_mpi_cols(plan_t *plan, const shape_t *s)
+{
+    const double cols = s->max_weight + 1.0;
+    const double halo = s->total_weight / (s->n ? s->n : 1);
+
+    plan->time = s->cells * CELL_COST / s->ranks +
+                 s->n * (MSG_COST + halo * sizeof(int_t) * BYTE_COST);
+
+    // The rank's columns with their halo, and their keep bits.
+    plan->memory = (cols / s->ranks + halo) * sizeof(int_t) +
+                   s->n * cols / 8 / s->ranks;
+}
+
+typedef struct
+{
+    const char *name;
+    pack_func_t pack;
+    estimate_func_t estimate;
+    int needs_mpi;
+} engine_t;
+
+typedef enum
+{
+    ENGINE_ALL,
+    ENGINE_NONE,
+    ENGINE_SEQ,
+    ENGINE_OMP,
+    ENGINE_SUBSET,
+    ENGINE_MITM,
+    ENGINE_MPI_PIPELINE,
+    ENGINE_MPI_COLS,
+    NUM_ENGINES
+} engine_id_t;
+
+static const engine_t
+engines[NUM_ENGINES] = {
+    [ENGINE_ALL]          = { "all",          pack_knapsack_all,          estimate_trivial,      0 },
+    [ENGINE_NONE]         = { "none",         pack_knapsack_none,         estimate_trivial,      0 },
+    [ENGINE_SEQ]          = { "seq",          pack_knapsack,              estimate_seq,          0 },
+    [ENGINE_OMP]          = { "omp",          pack_knapsack_omp,          estimate_omp,          0 },
+    [ENGINE_SUBSET]       = { "subset",       pack_knapsack_subset_omp,   estimate_subset,       0 },
+    [ENGINE_MITM]         = { "mitm",         pack_knapsack_mitm,         estimate_mitm,         0 },
+    [ENGINE_MPI_PIPELINE] = { "mpi-pipeline", pack_knapsack_mpi_pipeline, estimate_mpi_pipeline, 1 },
+    [ENGINE_MPI_COLS]     = { "mpi-cols",     pack_knapsack_mpi_cols,     estimate_mpi_cols,     1 },
+};
+
+static int
+engine_applies(engine_id_t e, const shape_t *s)
+{
+    switch (e)
+    {
+        case ENGINE_ALL:
+            return s->total_weight <= s->max_weight;
+        case ENGINE_NONE:
+            return s->total_value == 0;
+        case ENGINE_SUBSET:
+            return s->subset && s->ranks == 1;
+        case ENGINE_MITM:
+            return s->fitting <= MITM_MAX_ITEMS && s->ranks == 1;
+        case ENGINE_SEQ:
+        case ENGINE_OMP:
+        case ENGINE_MPI_PIPELINE:
+        case ENGINE_MPI_COLS:
+            // Under mpirun the ranks are there to be used.
+            return engines[e].needs_mpi == (s->ranks > 1);
+        default:
+            return 0;
+    }
+}
+
+static error_t
+measure_shape(shape_t *s, const knapsack_t *knapsack, const items_t *items)
+{
+    memset(s, 0, sizeof(shape_t));
+
+    s->n = items->count;
+    s->max_weight = knapsack->max_weight;
+    for (size_t i = 0; i < items->count; ++i)
+    {
+        // Saturated, a wrapped sum would make "all" look feasible.
+        s->total_weight = sat_add(s->total_weight, items->arr[i].weight);
+        s->total_value = sat_add(s->total_value, items->arr[i].value);
+    }
+    s->subset = is_subset_sum(items);
+    s->fitting = mitm_items(items, s->max_weight);
+
+    band_t band = new(band_t);
+    error_t err = init_band(&band, items, knapsack->max_weight);
+    if (err != OK)
+        return err;
+
+    s->cells = band_cells(&band);
+    drop_band(&band);
+
+    s->ram = available_ram() * RAM_USABLE;
+    s->cores = omp_get_num_procs();
+
+    int rank;
+    s->node_ranks = 1;
+    if (mpi_world(&rank, &s->ranks))
+    {
+        MPI_Comm node;
+        MPI_Comm_split_type(MPI_COMM_WORLD, MPI_COMM_TYPE_SHARED, 0,
+                            MPI_INFO_NULL, &node);
+        MPI_Comm_size(node, &s->node_ranks);
+        MPI_Comm_free(&node);
+    }
+    find_tune_mpi(&s->tune, knapsack->tunes, s->max_weight, s->n);
+
+    return OK;
+}
+
+error_t
+plan_knapsack(plan_t *plan, const knapsack_t *knapsack, const items_t *items,
+              FILE *log)
+{
+    assert(plan && knapsack && items);
+
+    int rank, size;
+    const int mpi = mpi_world(&rank, &size);
+
+    shape_t s;
+    int best = -1;
+
+    error_t err = measure_shape(&s, knapsack, items);
+    if (err == OK && rank == 0)
+    {
+        if (log)
+            fprintf(log, "Plan: n=%lu W=%lu total_weight=%lu total_value=%lu "
+                    "cells=%.0f ram=%.1fMiB cores=%d ranks=%d node_ranks=%d\n",
+                    s.n, s.max_weight, s.total_weight, s.total_value,
+                    s.cells, s.ram / MIB, s.cores, s.ranks, s.node_ranks);
+
+        for (engine_id_t e = 0; e < NUM_ENGINES; ++e)
+        {
+            if (!engine_applies(e, &s))
+                continue;
+
+            plan_t p = { .name = engines[e].name, .pack = engines[e].pack };
+            engines[e].estimate(&p, &s);
+            // The ranks sharing rank 0's node share its RAM too.
+            p.fits = p.memory * (engines[e].needs_mpi ? s.node_ranks : 1) <= s.ram;
+
+            if (log)
+                fprintf(log, "  %-12s time=%.6fs mem=%.1fMiB%s\n", p.name,
+                        p.time, p.memory / MIB, p.fits ? "" : " (does not fit)");
+
+            if (p.fits && (best < 0 || p.time < plan->time))
+            {
+                best = e;
+                *plan = p;
+            }
+        }
+    }
+
+    // The shape is the same everywhere, but free RAM need not be.
+    if (mpi)
+    {
+        MPI_Bcast(&best, 1, MPI_INT, 0, MPI_COMM_WORLD);
+        MPI_Bcast(&err, 1, MPI_INT, 0, MPI_COMM_WORLD);
+    }
+    if (err != OK)
+        return err;
+    if (best < 0)
+    {
+        if (rank == 0 && log)
+            fputs("Plan: no engine fits into memory\n", log);
+        return MEM_ERR;
+    }
+
+    if (rank != 0)
+    {
+        plan->name = engines[best].name;
+        plan->pack = engines[best].pack;
+        engines[best].estimate(plan, &s);
+        plan->fits = 1;
+    }
+
+    return OK;
+}
+
+error_t
+pack_knapsack_auto(knapsack_t *knapsack, double *dt, const items_t *items,
+                   FILE *log)
+{
+    plan_t plan;
+    error_t err = plan_knapsack(&plan, knapsack, items, log);
+    if (err != OK)
+        return err;
+
+    int rank, size;
+    mpi_world(&rank, &size);
+    if (rank == 0 && log)
+        fprintf(log, "Plan: chosen %s, predicted time=%.6fs mem=%.1fMiB\n",
+                plan.name, plan.time, plan.memory / MIB);
+
+    return plan.pack(knapsack, dt, items);
+}
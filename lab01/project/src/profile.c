@@ -0,0 +1,188 @@
+#include <assert.h>
+#include <stdlib.h>
+
+#include <omp.h>
+
+#include <macro.h>
+#include <profile.h>
+#include <tune.h>
+
+// Below this many columns a row is cheaper than a barrier.
+#define OMP_MIN_COLS 4096
+
+#define keep_row(profile, i) \
+    (&(profile)->keep[(i) * (profile)->words])
+
+/*
+ * Columns [a, b] of row i from the previous row, which covers [0, phi].
+ * a is a multiple of WORD_BITS, so threads never share a word of bits.
+ */
+static void
+profile_row(value_t *restrict cur, uint64_t *restrict bits,
+            const value_t *restrict prev, weight_t phi,
+            weight_t a, weight_t b, weight_t w, value_t v)
+{
+    for (weight_t base = a; base <= b; base += WORD_BITS)
+    {
+        const weight_t end = min(b, base + WORD_BITS - 1);
+
+        uint64_t word = 0;
+        for (weight_t c = base; c <= end; ++c)
+        {
+            const value_t skip = prev[min(c, phi)];
+            const value_t take = (c >= w) ? prev[min(c - w, phi)] + v : 0;
+
+            if (c >= w && take > skip)
+            {
+                cur[c] = take;
+                word |= (uint64_t)1 << (c - base);
+            }
+            else
+                cur[c] = skip;
+        }
+
+        bits[base / WORD_BITS] = word;
+    }
+}
+
+error_t
+solve_profile(profile_t *profile, double *dt,
+              const items_t *items, weight_t max_weight,
+              const tune_cache_t *tunes)
+{
+    assert(profile && dt && items);
+
+    const size_t n = items->count;
+    const size_t num_cols = max_weight + 1;
+
+    memset(profile, 0, sizeof(profile_t));
+    profile->max_weight = max_weight;
+    profile->count = n;
+    profile->words = bit_words(num_cols);
+
+    profile->best = malloc(num_cols * sizeof(value_t));
+    profile->hi = malloc((n + 1) * sizeof(weight_t));
+    profile->keep = malloc((n + 1) * profile->words * sizeof(uint64_t));
+    value_t *prev = malloc(num_cols * sizeof(value_t));
+    if (!profile->best || !profile->hi || !profile->keep || !prev)
+    {
+        free(prev);
+        drop_profile(profile);
+        return MEM_ERR;
+    }
+
+    tune_t tune;
+    find_tune(&tune, tunes, max_weight, n);
+
+    double t1 = omp_get_wtime();
+
+    profile->hi[0] = 0;
+    for (size_t i = 1; i <= n; ++i)
+        profile->hi[i] = min(max_weight,
+                             sat_add(profile->hi[i - 1], items->arr[i - 1].weight));
+
+    // best[] and prev take turns, so that the last row ends up in best[].
+    value_t *cur = (n % 2) ? profile->best : prev;
+    value_t *old = (n % 2) ? prev : profile->best;
+    old[0] = 0;
+
+    #pragma omp parallel num_threads(tune.num_threads) if(num_cols >= OMP_MIN_COLS)
+    {
+        const size_t num_threads = omp_get_num_threads();
+        const size_t thread = omp_get_thread_num();
+
+        value_t *c_row = cur, *p_row = old;
+        for (size_t i = 1; i <= n; ++i)
+        {
+            const item_t *item = &items->arr[i - 1];
+            const size_t row_words = bit_words(profile->hi[i] + 1);
+
+            const size_t wa = row_words * thread / num_threads;
+            const size_t wb = row_words * (thread + 1) / num_threads;
+            if (wa < wb)
+                profile_row(c_row, keep_row(profile, i), p_row, profile->hi[i - 1],
+                            wa * WORD_BITS, min(profile->hi[i], wb * WORD_BITS - 1),
+                            item->weight, item->value);
+
+            value_t *tmp = c_row;
+            c_row = p_row;
+            p_row = tmp;
+
+            #pragma omp barrier
+        }
+    }
+
+    // Every capacity above hi[n] fits all the items.
+    for (weight_t c = profile->hi[n] + 1; c < num_cols; ++c)
+        profile->best[c] = profile->best[profile->hi[n]];
+
+    *dt = omp_get_wtime() - t1;
+
+    free(prev);
+    return OK;
+}
+
+void
+drop_profile(profile_t *profile)
+{
+    free(profile->keep);
+    free(profile->hi);
+    free(profile->best);
+    memset(profile, 0, sizeof(profile_t));
+}
+
+error_t
+trace_profile(knapsack_t *knapsack, const profile_t *profile,
+              const items_t *items, weight_t capacity)
+{
+    assert(knapsack && profile && items);
+
+    if (capacity > profile->max_weight || items->count != profile->count)
+        return ARG_ERR;
+
+    unsigned char *chosen = calloc(profile->count + 1, 1);
+    if (!chosen)
+        return MEM_ERR;
+
+    knapsack->max_weight = capacity;
+
+    weight_t c = capacity;
+    for (size_t i = profile->count; i > 0; --i)
+    {
+        c = min(c, profile->hi[i]);
+        if (test_bit(keep_row(profile, i), c))
+        {
+            chosen[i - 1] = 1;
+            c -= items->arr[i - 1].weight;
+        }
+    }
+
+    error_t err = OK;
+    for (size_t i = profile->count; err == OK && i > 0; --i)
+        if (chosen[i - 1])
+            err = add_item_to_knapsack(knapsack, &items->arr[i - 1]);
+
+    free(chosen);
+    return err;
+}
+
+error_t
+write_profile(FILE *f, const profile_t *profile, int breakpoints)
+{
+    assert(f && profile && profile->best);
+
+    size_t points = 0;
+    for (weight_t c = 0; c <= profile->max_weight; ++c)
+        if (!breakpoints || c == 0 || profile->best[c] > profile->best[c - 1])
+            ++points;
+
+    if (fprintf(f, INT_FMT"\n", points) < 1)
+        return FIO_ERR;
+
+    for (weight_t c = 0; c <= profile->max_weight; ++c)
+        if (!breakpoints || c == 0 || profile->best[c] > profile->best[c - 1])
+            if (fprintf(f, INT_FMT" "INT_FMT"\n", c, profile->best[c]) < 1)
+                return FIO_ERR;
+
+    return OK;
+}
@@ -0,0 +1,244 @@
+#include <assert.h>
+#include <stdlib.h>
+
+#include <macro.h>
+#include <solver.h>
+#include <stream.h>
+#include <tune.h>
+
+struct solver
+{
+    weight_t max_weight;
+    items_t items;
+
+    knapsack_t result;
+    double dt;
+
+    tune_cache_t tunes;
+};
+
+solver_t *
+create_solver(void)
+{
+    solver_t *solver = calloc(1, sizeof(solver_t));
+    if (!solver)
+        return NULL;
+
+    if (init_items(&solver->items) != OK ||
+        init_knapsack(&solver->result) != OK)
+    {
+        destroy_solver(solver);
+        return NULL;
+    }
+
+    return solver;
+}
+
+void
+destroy_solver(solver_t *solver)
+{
+    if (!solver)
+        return;
+
+    drop_knapsack(&solver->result);
+    drop_items(&solver->items);
+    drop_tune_cache(&solver->tunes);
+    free(solver);
+}
+
+static error_t
+reset_result(solver_t *solver)
+{
+    drop_knapsack(&solver->result);
+    solver->dt = 0;
+
+    error_t err = init_knapsack(&solver->result);
+    solver->result.max_weight = solver->max_weight;
+    solver->result.tunes = &solver->tunes;
+    return err;
+}
+
+static error_t
+reset_task(solver_t *solver)
+{
+    drop_items(&solver->items);
+    solver->max_weight = 0;
+
+    error_t err = init_items(&solver->items);
+    if (err != OK)
+        return err;
+
+    return reset_result(solver);
+}
+
+error_t
+solver_load_tune(solver_t *solver, const char *path)
+{
+    assert(solver);
+
+    drop_tune_cache(&solver->tunes);
+    return load_tune_cache(&solver->tunes, path);
+}
+
+error_t
+solver_read(solver_t *solver, FILE *f)
+{
+    assert(solver && f);
+
+    error_t err = reset_task(solver);
+    if (err != OK)
+        return err;
+
+    err = read_knapsack_info(f, &solver->result);
+    if (err != OK)
+        return err;
+
+    solver->max_weight = solver->result.max_weight;
+    return read_items_info(f, &solver->items);
+}
+
+error_t
+solver_read_mpi(solver_t *solver, FILE *f)
+{
+    assert(solver);
+
+    error_t err = reset_task(solver);
+    if (err != OK)
+        return err;
+
+    err = read_knapsack_mpi(f, &solver->result, &solver->items);
+    solver->max_weight = solver->result.max_weight;
+
+    return err;
+}
+
+error_t
+solver_parse(solver_t *solver, const char *buf, size_t len)
+{
+    assert(solver && buf);
+
+    if (len == 0)
+        return FMT_ERR;
+
+    FILE *f = fmemopen((void *)buf, len, "r");
+    if (!f)
+        return MEM_ERR;
+
+    error_t err = solver_read(solver, f);
+    fclose(f);
+
+    return err;
+}
+
+error_t
+solver_set_task(solver_t *solver, weight_t max_weight, const items_t *items)
+{
+    assert(solver && items);
+
+    error_t err = reset_task(solver);
+    if (err != OK)
+        return err;
+
+    solver->max_weight = max_weight;
+    solver->result.max_weight = max_weight;
+
+    for (size_t i = 0; err == OK && i < items->count; ++i)
+        err = add_item_to_items(&solver->items, &items->arr[i]);
+
+    return err;
+}
+
+error_t
+solver_solve(solver_t *solver, pack_func_t pack)
+{
+    assert(solver && pack);
+
+    error_t err = reset_result(solver);
+    if (err != OK)
+        return err;
+
+    return pack(&solver->result, &solver->dt, &solver->items);
+}
+
+error_t
+solver_stream(solver_t *solver, FILE *src, FILE *dst)
+{
+    assert(solver && src && dst);
+
+    error_t err = reset_task(solver);
+    if (err != OK)
+        return err;
+
+    err = stream_knapsack(src, dst, &solver->result, &solver->dt);
+    solver->max_weight = solver->result.max_weight;
+
+    return err;
+}
+
+error_t
+solver_write(const solver_t *solver, FILE *f)
+{
+    assert(solver && f);
+    return write_knapsack_info(f, &solver->result);
+}
+
+error_t
+solver_format(const solver_t *solver, char **buf, size_t *len)
+{
+    assert(solver && buf && len);
+
+    *buf = NULL;
+    *len = 0;
+
+    FILE *f = open_memstream(buf, len);
+    if (!f)
+        return MEM_ERR;
+
+    error_t err = solver_write(solver, f);
+    if (fclose(f) != 0 && err == OK)
+        err = MEM_ERR;
+
+    if (err != OK)
+    {
+        free(*buf);
+        *buf = NULL;
+        *len = 0;
+    }
+
+    return err;
+}
+
+weight_t
+solver_max_weight(const solver_t *solver)
+{
+    assert(solver);
+    return solver->max_weight;
+}
+
+const items_t *
+solver_items(const solver_t *solver)
+{
+    assert(solver);
+    return &solver->items;
+}
+
+const knapsack_t *
+solver_result(const solver_t *solver)
+{
+    assert(solver);
+    return &solver->result;
+}
+
+const tune_cache_t *
+solver_tunes(const solver_t *solver)
+{
+    assert(solver);
+    return &solver->tunes;
+}
+
+double
+solver_duration(const solver_t *solver)
+{
+    assert(solver);
+    return solver->dt;
+}
@@ -0,0 +1,409 @@
+#define _GNU_SOURCE
+
+#include <assert.h>
+#include <stdlib.h>
+#include <stdatomic.h>
+
+#include <omp.h>
+#include <sched.h>
+#include <pthread.h>
+
+#include <macro.h>
+#include <stream.h>
+#include <band.h>
+#include <tune.h>
+
+#define RING_SIZE 4096
+
+// Items taken off the ring at a time. The threads meet once per batch;
+// within it they only wait for the threads whose columns they read.
+#define STREAM_BATCH 64
+
+#define CACHE_LINE 64
+
+/*
+ * Single-producer/single-consumer ring: only the reader moves the tail and
+ * only the solver moves the head, so a release store on one side and an
+ * acquire load on the other is all the synchronisation needed.
+ */
+typedef struct
+{
+    item_t slots[RING_SIZE];
+
+    _Atomic size_t head;
+    _Atomic size_t tail;
+
+    _Atomic int done;
+    _Atomic int cancel;
+    error_t err;
+
+    FILE *src;
+    size_t count;
+} ring_t;
+
+static int
+ring_push(ring_t *ring, const item_t *item)
+{
+    const size_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    if (tail - atomic_load_explicit(&ring->head, memory_order_acquire) == RING_SIZE)
+        return 0;
+
+    ring->slots[tail % RING_SIZE] = *item;
+    atomic_store_explicit(&ring->tail, tail + 1, memory_order_release);
+    return 1;
+}
+
+static int
+ring_pop(ring_t *ring, item_t *item)
+{
+    const size_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    if (head == atomic_load_explicit(&ring->tail, memory_order_acquire))
+        return 0;
+
+    *item = ring->slots[head % RING_SIZE];
+    atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+    return 1;
+}
+
+static void *
+reader_main(void *arg)
+{
+    ring_t *ring = arg;
+
+    error_t err = OK;
+    for (size_t i = 0; i < ring->count; ++i)
+    {
+        item_t item = { 0 };
+        if ((err = read_item_info(ring->src, &item)) != OK)
+            break;
+
+        while (!ring_push(ring, &item))
+        {
+            if (atomic_load_explicit(&ring->cancel, memory_order_relaxed))
+                goto out;
+            sched_yield();
+        }
+    }
+
+out:
+    ring->err = err;
+    atomic_store_explicit(&ring->done, 1, memory_order_release);
+    return NULL;
+}
+
+// Returns 1 with the next item, or 0 once the reader is done and the ring
+// is drained.
+static int
+ring_next(ring_t *ring, item_t *item)
+{
+    loop
+    {
+        if (ring_pop(ring, item))
+            return 1;
+        if (atomic_load_explicit(&ring->done, memory_order_acquire))
+            return ring_pop(ring, item);
+        sched_yield();
+    }
+}
+
+typedef struct
+{
+    FILE *dst;
+
+    char *buf;
+    size_t len;
+
+    error_t err;
+} writer_t;
+
+static void *
+writer_main(void *arg)
+{
+    writer_t *writer = arg;
+
+    if (fwrite(writer->buf, 1, writer->len, writer->dst) != writer->len ||
+            fflush(writer->dst) != 0)
+        writer->err = FIO_ERR;
+
+    return NULL;
+}
+
+/*
+ * Rows are only known as they arrive, so there is no suffix weight and no
+ * reordering here: a row spans [0, min(W, prefix weight)], and columns
+ * past it read as its last cell.
+ */
+typedef struct
+{
+    int_t **rows;
+    weight_t *hi;
+    size_t count;
+    size_t capacity;
+} stream_table_t;
+
+static error_t
+table_push_row(stream_table_t *table, weight_t hi)
+{
+    if (table->count == table->capacity)
+    {
+        size_t new_cap = 2 * table->capacity;
+        int_t **new_rows = realloc(table->rows, new_cap * sizeof(int_t *));
+        weight_t *new_hi = realloc(table->hi, new_cap * sizeof(weight_t));
+        if (new_rows)
+            table->rows = new_rows;
+        if (new_hi)
+            table->hi = new_hi;
+        if (!new_rows || !new_hi)
+            return MEM_ERR;
+
+        table->capacity = new_cap;
+    }
+
+    int_t *row = malloc((hi + 1) * sizeof(int_t));
+    if (!row)
+        return MEM_ERR;
+
+    table->rows[table->count] = row;
+    table->hi[table->count] = hi;
+    ++table->count;
+
+    return OK;
+}
+
+static void
+drop_table(stream_table_t *table)
+{
+    for (size_t i = 0; i < table->count; ++i)
+        free(table->rows[i]);
+
+    free(table->hi);
+    free(table->rows);
+}
+
+// Last row a thread has finished, padded against false sharing.
+typedef struct
+{
+    _Atomic size_t row;
+    char pad[CACHE_LINE - sizeof(size_t)];
+} progress_t;
+
+#define strip_lo(width, thread, num_threads) \
+    ((width) * (thread) / (num_threads))
+
+// Waits until every thread whose part of row i - 1 (of width columns)
+// overlaps [from, to] is done with that row.
+static void
+wait_prev_row(progress_t *done, int num_threads, size_t i,
+              weight_t width, weight_t from, weight_t to)
+{
+    for (int s = 0; s < num_threads; ++s)
+    {
+        const weight_t a = strip_lo(width, s, num_threads);
+        const weight_t b = strip_lo(width, s + 1, num_threads);
+        if (a >= b || b <= from || a > to)
+            continue;
+
+        while (atomic_load_explicit(&done[s].row, memory_order_acquire) < i - 1)
+            sched_yield();
+    }
+}
+
+#define table_at(t, i, j) \
+    ((t)->rows[i][min((j), (t)->hi[i])])
+
+static void
+trace_table(knapsack_t *knapsack, const items_t *items, const stream_table_t *table)
+{
+    unsigned char *chosen = calloc(items->count + 1, 1);
+    if (!chosen)
+        return;
+
+    weight_t w = knapsack->max_weight;
+    for (size_t i = items->count; i > 0; --i)
+        if (table_at(table, i, w) != table_at(table, i - 1, w))
+        {
+            chosen[i - 1] = 1;
+            w -= items->arr[i - 1].weight;
+        }
+
+    for (size_t i = items->count; i > 0; --i)
+        if (chosen[i - 1])
+            add_item_to_knapsack(knapsack, &items->arr[i - 1]);
+
+    free(chosen);
+}
+
+error_t
+stream_knapsack(FILE *src, FILE *dst, knapsack_t *knapsack, double *dt)
+{
+    assert(src && dst && knapsack && dt);
+
+    double t1 = omp_get_wtime();
+
+    error_t err = read_knapsack_info(src, knapsack);
+    if (err != OK)
+        return err;
+
+    ring_t *ring = calloc(1, sizeof(ring_t));
+    if (!ring)
+        return MEM_ERR;
+
+    ring->src = src;
+    if ((err = read_items_count(src, &ring->count)) != OK)
+    {
+        free(ring);
+        return err;
+    }
+
+    items_t items = new(items_t);
+    stream_table_t table = { .capacity = INITIAL_ITEMS_CAPACITY };
+    table.rows = malloc(table.capacity * sizeof(int_t *));
+    table.hi = malloc(table.capacity * sizeof(weight_t));
+
+    if ((err = init_items(&items)) != OK ||
+            !table.rows || !table.hi ||
+            (err = table_push_row(&table, 0)) != OK)
+    {
+        err = MEM_ERR;
+        goto free_out;
+    }
+    table.rows[0][0] = 0;
+
+    pthread_t reader;
+    if (pthread_create(&reader, NULL, reader_main, ring) != 0)
+    {
+        err = MEM_ERR;
+        goto free_out;
+    }
+
+    // The item count is known up front, so the tuned thread count applies.
+    tune_t tune;
+    find_tune(&tune, knapsack->tunes, knapsack->max_weight, ring->count);
+
+    progress_t *done = calloc(tune.num_threads, sizeof(progress_t));
+    if (!done)
+    {
+        err = MEM_ERR;
+        atomic_store_explicit(&ring->cancel, 1, memory_order_relaxed);
+        pthread_join(reader, NULL);
+        goto free_out;
+    }
+
+    const weight_t max_weight = knapsack->max_weight;
+    weight_t prefix = 0;
+    size_t first = 0;
+    int stop = 0;
+
+    #pragma omp parallel default(shared) num_threads(tune.num_threads)
+    {
+        const int num_threads = omp_get_num_threads();
+        const int thread = omp_get_thread_num();
+
+        loop
+        {
+            // Only the first item of a batch is waited for, the rest is
+            // whatever the reader has got ready.
+            #pragma omp single
+            {
+                first = table.count;
+                for (size_t k = 0; k < STREAM_BATCH; ++k)
+                {
+                    item_t item = { 0 };
+                    if (!(k == 0 ? ring_next(ring, &item) : ring_pop(ring, &item)))
+                    {
+                        stop = (k == 0);
+                        break;
+                    }
+
+                    if ((err = add_item_to_items(&items, &item)) != OK ||
+                            (err = table_push_row(&table, min(max_weight, sat_add(prefix, item.weight)))) != OK)
+                    {
+                        stop = 1;
+                        break;
+                    }
+                    prefix = sat_add(prefix, item.weight);
+                }
+            }
+
+            if (stop)
+                break;
+
+            for (size_t i = first; i < table.count; ++i)
+            {
+                const item_t *item = &items.arr[i - 1];
+                const weight_t width = table.hi[i] + 1;
+                const weight_t phi = table.hi[i - 1];
+
+                const weight_t a = strip_lo(width, thread, num_threads);
+                const weight_t b = strip_lo(width, thread + 1, num_threads);
+
+                if (a < b)
+                {
+                    // Columns a - w .. b - 1 of the previous row, clamped
+                    // to its last one.
+                    const weight_t from = (a > item->weight) ? a - item->weight : 0;
+                    wait_prev_row(done, num_threads, i, phi + 1,
+                                  min(from, phi), min(b - 1, phi));
+
+                    band_row(table.rows[i], 0, a, b - 1,
+                             table.rows[i - 1], 0, phi,
+                             item->weight, item->value);
+                }
+
+                atomic_store_explicit(&done[thread].row, i, memory_order_release);
+            }
+
+            // The next batch grows the table, nobody may be reading it.
+            #pragma omp barrier
+        }
+    }
+
+    free(done);
+
+    atomic_store_explicit(&ring->cancel, 1, memory_order_relaxed);
+    pthread_join(reader, NULL);
+    if (err == OK)
+        err = ring->err;
+    if (err == OK && items.count != ring->count)
+        err = FMT_ERR;
+    if (err != OK)
+        goto free_out;
+
+    trace_table(knapsack, &items, &table);
+
+    writer_t writer = { .dst = dst };
+    FILE *mem = open_memstream(&writer.buf, &writer.len);
+    if (!mem)
+    {
+        err = MEM_ERR;
+        goto free_out;
+    }
+
+    err = write_knapsack_info(mem, knapsack);
+    if (fclose(mem) != 0 && err == OK)
+        err = MEM_ERR;
+
+    pthread_t writer_thread;
+    int writing = err == OK &&
+        pthread_create(&writer_thread, NULL, writer_main, &writer) == 0;
+    if (err == OK && !writing)
+        writer_main(&writer);
+
+    drop_table(&table);
+    drop_items(&items);
+    free(ring);
+
+    if (writing)
+        pthread_join(writer_thread, NULL);
+    free(writer.buf);
+
+    *dt = omp_get_wtime() - t1;
+    return (err != OK) ? err : writer.err;
+
+free_out:
+    drop_table(&table);
+    drop_items(&items);
+    free(ring);
+
+    return err;
+}
@@ -0,0 +1,205 @@
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+#include <omp.h>
+
+#include <macro.h>
+#include <knapsack.h>
+#include <tune.h>
+
+typedef uint64_t word_t;
+
+// Below this many words a step is cheaper than waking the team up.
+#define OMP_MIN_WORDS 2048
+
+// Words holding the bits of capacities 0..c.
+#define num_words(c) \
+    bit_words((c) + 1)
+
+int
+is_subset_sum(const items_t *items)
+{
+    assert(items);
+
+    for (size_t i = 0; i < items->count; ++i)
+        if (items->arr[i].value != items->arr[i].weight)
+            return 0;
+
+    return items->count > 0;
+}
+
+/*
+ * Subset-sum as reachability: bit c of R_i is set iff some subset of the
+ * first i items weighs exactly c, and R_i = R_{i-1} | R_{i-1} << w_i. A
+ * word of the result depends on two words of the previous set only, so
+ * the words of one step are independent.
+ */
+static void
+shift_or(word_t *restrict dst, const word_t *restrict src,
+         size_t a, size_t b, weight_t w)
+{
+    const size_t q = w / WORD_BITS;
+    const unsigned r = w % WORD_BITS;
+
+    for (size_t k = a; k < min(b, q); ++k)
+        dst[k] = src[k];
+
+    if (r == 0)
+    {
+        #pragma omp simd
+        for (size_t k = a > q ? a : q; k < b; ++k)
+            dst[k] = src[k] | src[k - q];
+        return;
+    }
+
+    if (a <= q && q < b)
+        dst[q] = src[q] | (src[0] << r);
+
+    #pragma omp simd
+    for (size_t k = a > q + 1 ? a : q + 1; k < b; ++k)
+        dst[k] = src[k] | (src[k - q] << r) | (src[k - q - 1] >> (WORD_BITS - r));
+}
+
+// Only the words up to the prefix weight can be set, the rest stay zero.
+static void
+step(word_t *restrict dst, const word_t *restrict src,
+     size_t words, weight_t w, int num_threads)
+{
+    if (num_threads == 1 || words < OMP_MIN_WORDS)
+    {
+        shift_or(dst, src, 0, words, w);
+        return;
+    }
+
+    #pragma omp parallel num_threads(num_threads)
+    {
+        const size_t t = omp_get_thread_num();
+        const size_t nt = omp_get_num_threads();
+        shift_or(dst, src, words * t / nt, words * (t + 1) / nt, w);
+    }
+}
+
+/*
+ * Only every k-th set is kept on the way forward. The trace back then
+ * replays one segment of k items at a time from its checkpoint, so both
+ * passes together hold about 2 * sqrt(n) sets instead of n.
+ */
+static error_t
+pack_subset_with(knapsack_t *knapsack, double *dt, const items_t *items,
+                 int num_threads)
+{
+    assert(knapsack && items);
+
+    const weight_t max_weight = knapsack->max_weight;
+    const size_t n = items->count;
+    const size_t words = num_words(max_weight);
+
+    const size_t k = (size_t)ceil(sqrt((double)n)) + 1;
+    const size_t num_cps = n / k + 1;
+
+    word_t *cps = calloc(num_cps * words, sizeof(word_t));
+    word_t *seg = calloc((k + 1) * words, sizeof(word_t));
+    weight_t *active = malloc((n + 1) * sizeof(weight_t));
+    if (!cps || !seg || !active)
+    {
+        free(active);
+        free(seg);
+        free(cps);
+        return MEM_ERR;
+    }
+
+    double t1 = omp_get_wtime();
+
+    active[0] = 0;
+    for (size_t i = 0; i < n; ++i)
+    {
+        const weight_t w = items->arr[i].weight;
+        active[i + 1] = min(max_weight, active[i] + min(w, max_weight));
+    }
+
+    // Forward: two sets of seg take turns, every k-th lands in cps.
+    word_t *cur = seg, *nxt = seg + words;
+    cur[0] = 1;
+    for (size_t i = 0; i < n; ++i)
+    {
+        if (i % k == 0)
+            memcpy(&cps[i / k * words], cur, num_words(active[i]) * sizeof(word_t));
+
+        step(nxt, cur, num_words(active[i + 1]), items->arr[i].weight, num_threads);
+
+        word_t *tmp = cur;
+        cur = nxt;
+        nxt = tmp;
+    }
+
+    weight_t best = active[n];
+    while (!test_bit(cur, best))
+        --best;
+
+    unsigned char *chosen = calloc(n + 1, 1);
+    if (!chosen)
+    {
+        free(active);
+        free(seg);
+        free(cps);
+        return MEM_ERR;
+    }
+
+    // Backward: item i is needed iff best is out of reach without it.
+    weight_t c = best;
+    for (size_t j = num_cps; j > 0 && c > 0; --j)
+    {
+        const size_t s = (j - 1) * k;
+        const size_t e = min(n, s + k);
+        if (s >= e)
+            continue;
+
+        // Steps only write up to their prefix weight, so clear what an
+        // earlier (heavier) segment left behind.
+        memset(seg, 0, (e - s) * words * sizeof(word_t));
+        memcpy(seg, &cps[(j - 1) * words], words * sizeof(word_t));
+        for (size_t i = s; i < e - 1; ++i)
+            step(&seg[(i - s + 1) * words], &seg[(i - s) * words],
+                 num_words(active[i + 1]), items->arr[i].weight, num_threads);
+
+        for (size_t i = e; i > s && c > 0; --i)
+        {
+            if (c <= active[i - 1] && test_bit(&seg[(i - 1 - s) * words], c))
+                continue;
+
+            chosen[i - 1] = 1;
+            c -= items->arr[i - 1].weight;
+        }
+    }
+
+    error_t err = OK;
+    for (size_t i = n; err == OK && i > 0; --i)
+        if (chosen[i - 1])
+            err = add_item_to_knapsack(knapsack, &items->arr[i - 1]);
+
+    *dt = omp_get_wtime() - t1;
+
+    free(chosen);
+    free(active);
+    free(seg);
+    free(cps);
+
+    return err;
+}
+
+error_t
+pack_knapsack_subset(knapsack_t *knapsack, double *dt, const items_t *items)
+{
+    return pack_subset_with(knapsack, dt, items, 1);
+}
+
+error_t
+pack_knapsack_subset_omp(knapsack_t *knapsack, double *dt, const items_t *items)
+{
+    tune_t tune;
+    find_tune(&tune, knapsack->tunes, knapsack->max_weight, items->count);
+
+    return pack_subset_with(knapsack, dt, items, tune.num_threads);
+}
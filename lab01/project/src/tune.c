@@ -0,0 +1,367 @@
+#include <assert.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <limits.h>
+#include <math.h>
+
+#include <omp.h>
+#include <mpi.h>
+
+#include <macro.h>
+#include <tune.h>
+
+#define KEY_SIZE 128
+#define LINE_SIZE 256
+
+#define TUNE_REPEATS 2
+
+void
+default_tune(tune_t *tune)
+{
+    assert(tune);
+
+    tune->num_threads = omp_get_max_threads();
+    tune->block_rows = DEFAULT_BLOCK_ROWS;
+    tune->block_cols = DEFAULT_BLOCK_COLS;
+}
+
+const char *
+tune_file_path(char *path, size_t size)
+{
+    assert(path && size);
+
+    const char *env = getenv(TUNE_FILE_ENV);
+    if (env && *env)
+        return env;
+
+    const char *home = getenv("HOME");
+    snprintf(path, size, "%s/%s", home ? home : ".", TUNE_FILE_NAME);
+    return path;
+}
+
+static unsigned
+bucket_of(uint64_t x)
+{
+    unsigned b = 0;
+    while (x >>= 1)
+        ++b;
+    return b;
+}
+
+// The buckets of the sample the instance is tuned on.
+static void
+bucket_key(unsigned *wb, unsigned *nb, weight_t max_weight, size_t num_items)
+{
+    *wb = bucket_of(min(max_weight, TUNE_SAMPLE_COLS - 1) + 1);
+    *nb = bucket_of(min(num_items, TUNE_SAMPLE_ITEMS) + 1);
+}
+
+// Same host name and core count is taken to be the same machine.
+static void
+machine_key(char *key, size_t size)
+{
+    char host[KEY_SIZE / 2] = "unknown";
+    gethostname(host, sizeof(host) - 1);
+
+    for (char *p = host; *p; ++p)
+        if (*p == ' ')
+            *p = '_';
+
+    snprintf(key, size, "%s:%d", host, omp_get_num_procs());
+}
+
+static int
+parse_line(const char *line, char *key, unsigned *wb, unsigned *nb, tune_t *tune)
+{
+    return sscanf(line, "%127s %u %u %d %zu %zu", key, wb, nb,
+                  &tune->num_threads, &tune->block_rows, &tune->block_cols) == 6 &&
+           tune->num_threads > 0 && tune->block_rows > 0 && tune->block_cols > 0;
+}
+
+error_t
+load_tune_cache(tune_cache_t *cache, const char *path)
+{
+    assert(cache);
+
+    memset(cache, 0, sizeof(tune_cache_t));
+
+    char buf[PATH_MAX];
+    FILE *f = fopen(path ? path : tune_file_path(buf, sizeof(buf)), "r");
+    if (!f)
+        return OK;
+
+    char machine[KEY_SIZE];
+    machine_key(machine, sizeof(machine));
+
+    error_t err = OK;
+    size_t capacity = 0;
+
+    char line[LINE_SIZE];
+    while (err == OK && fgets(line, sizeof(line), f))
+    {
+        char key[KEY_SIZE];
+        tune_entry_t entry;
+
+        if (!parse_line(line, key, &entry.wb, &entry.nb, &entry.tune) ||
+                strcmp(key, machine) != 0)
+            continue;
+
+        if (cache->count == capacity)
+        {
+            capacity = capacity ? 2 * capacity : 8;
+            tune_entry_t *arr = realloc(cache->arr, capacity * sizeof(tune_entry_t));
+            if (!arr)
+            {
+                err = MEM_ERR;
+                break;
+            }
+            cache->arr = arr;
+        }
+
+        cache->arr[cache->count++] = entry;
+    }
+
+    fclose(f);
+
+    if (err != OK)
+        drop_tune_cache(cache);
+    return err;
+}
+
+void
+drop_tune_cache(tune_cache_t *cache)
+{
+    assert(cache);
+
+    free(cache->arr);
+    cache->arr = NULL;
+    cache->count = 0;
+}
+
+void
+find_tune(tune_t *tune, const tune_cache_t *cache,
+          weight_t max_weight, size_t num_items)
+{
+    assert(tune);
+
+    default_tune(tune);
+    if (!cache)
+        return;
+
+    unsigned wb, nb;
+    bucket_key(&wb, &nb, max_weight, num_items);
+
+    // A later line overrides an earlier one.
+    for (size_t i = 0; i < cache->count; ++i)
+        if (cache->arr[i].wb == wb && cache->arr[i].nb == nb)
+            *tune = cache->arr[i].tune;
+}
+
+void
+find_tune_mpi(tune_t *tune, const tune_cache_t *cache,
+              weight_t max_weight, size_t num_items)
+{
+    assert(tune);
+
+    int rank, size;
+    const int mpi = mpi_world(&rank, &size);
+    if (rank == 0)
+        find_tune(tune, cache, max_weight, num_items);
+
+    if (mpi)
+        MPI_Bcast(tune, sizeof(tune_t), MPI_BYTE, 0, MPI_COMM_WORLD);
+}
+
+error_t
+save_tune(const char *path, const tune_t *tune,
+          weight_t max_weight, size_t num_items)
+{
+    assert(path && tune);
+
+    char machine[KEY_SIZE];
+    machine_key(machine, sizeof(machine));
+
+    unsigned wb, nb;
+    bucket_key(&wb, &nb, max_weight, num_items);
+
+    char tmp_path[PATH_MAX];
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+
+    FILE *out = fopen(tmp_path, "w");
+    if (!out)
+        return FIO_ERR;
+
+    // Keep every other entry, replace the one for this machine and bucket.
+    FILE *in = fopen(path, "r");
+    if (in)
+    {
+        char line[LINE_SIZE];
+        while (fgets(line, sizeof(line), in))
+        {
+            char key[KEY_SIZE];
+            unsigned lwb = 0, lnb = 0;
+            tune_t entry;
+
+            if (!parse_line(line, key, &lwb, &lnb, &entry))
+                continue;
+            if (strcmp(key, machine) == 0 && lwb == wb && lnb == nb)
+                continue;
+
+            fputs(line, out);
+        }
+        fclose(in);
+    }
+
+    fprintf(out, "%s %u %u %d %zu %zu\n", machine, wb, nb,
+            tune->num_threads, tune->block_rows, tune->block_cols);
+
+    if (fclose(out) != 0 || rename(tmp_path, path) != 0)
+        return FIO_ERR;
+
+    return OK;
+}
+
+static const size_t
+grid_rows[] = { 8, 16, 32, 64, 128 };
+
+static const size_t
+grid_cols[] = { 64, 256, 1024, 4096 };
+
+#define ARR_LEN(a) \
+    (sizeof(a) / sizeof((a)[0]))
+
+// A smaller copy of the task: every stride-th item, and the capacity
+// capped with the weights scaled along, so that about as many items fit.
+static error_t
+sample_task(weight_t *sample_weight, items_t *sample,
+            weight_t max_weight, const items_t *items)
+{
+    const size_t stride =
+        max((items->count + TUNE_SAMPLE_ITEMS - 1) / TUNE_SAMPLE_ITEMS, 1);
+    const weight_t cap = min(max_weight, TUNE_SAMPLE_COLS - 1);
+    const double scale = max_weight ? (double)cap / max_weight : 1;
+
+    *sample_weight = cap;
+
+    error_t err = OK;
+    for (size_t i = 0; err == OK && i < items->count; i += stride)
+    {
+        item_t item = items->arr[i];
+        if (cap < max_weight)
+            item.weight = (item.weight > max_weight) ? cap + 1
+                        : (weight_t)ceil(item.weight * scale);
+
+        err = add_item_to_items(sample, &item);
+    }
+
+    return err;
+}
+
+// Best of TUNE_REPEATS, as seen by the slowest rank.
+static error_t
+time_solve(double *best, pack_func_t pack, const tune_t *tune,
+           weight_t max_weight, const items_t *items)
+{
+    // A cache of just the probed configuration.
+    tune_entry_t entry = { .tune = *tune };
+    bucket_key(&entry.wb, &entry.nb, max_weight, items->count);
+    const tune_cache_t probe = { .count = 1, .arr = &entry };
+
+    *best = 0;
+    for (int r = 0; r < TUNE_REPEATS; ++r)
+    {
+        knapsack_t knapsack = new(knapsack_t);
+        error_t err = init_knapsack(&knapsack);
+        if (err != OK)
+            return err;
+
+        knapsack.max_weight = max_weight;
+        knapsack.tunes = &probe;
+
+        double dt = 0;
+        err = pack(&knapsack, &dt, items);
+        drop_knapsack(&knapsack);
+        if (err != OK)
+            return err;
+
+        MPI_Allreduce(MPI_IN_PLACE, &dt, 1, MPI_DOUBLE, MPI_MAX, MPI_COMM_WORLD);
+        if (r == 0 || dt < *best)
+            *best = dt;
+    }
+
+    return OK;
+}
+
+error_t
+autotune_knapsack(tune_t *best, weight_t max_weight, const items_t *items,
+                  FILE *log)
+{
+    assert(best && items);
+
+    double best_dt = 0, dt = 0;
+
+    int rank = 0;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    // Every rank holds the same items, so they all draw the same sample.
+    weight_t sample_weight = 0;
+    items_t sample = new(items_t);
+    error_t err = init_items(&sample);
+    if (err == OK)
+        err = sample_task(&sample_weight, &sample, max_weight, items);
+    MPI_Allreduce(MPI_IN_PLACE, &err, 1, MPI_INT, MPI_MAX, MPI_COMM_WORLD);
+    if (err != OK)
+        goto out;
+
+    if (rank == 0 && log)
+        fprintf(log, "sample n=%lu W=%lu\n", sample.count, sample_weight);
+
+    default_tune(best);
+    tune_t probe = *best;
+
+    // Thread count and MPI blocking do not interact, so they are tuned
+    // one after the other instead of over the full product.
+    const int num_procs = omp_get_num_procs();
+    for (int th = 1; ; th = (th * 2 < num_procs) ? th * 2 : num_procs)
+    {
+        probe.num_threads = th;
+        if ((err = time_solve(&dt, pack_knapsack_omp, &probe, sample_weight, &sample)) != OK)
+            goto out;
+
+        if (rank == 0 && log)
+            fprintf(log, "omp threads=%d dt=%lf\n", th, dt);
+        if (th == 1 || dt < best_dt)
+        {
+            best_dt = dt;
+            best->num_threads = th;
+        }
+
+        if (th == num_procs)
+            break;
+    }
+
+    probe = *best;
+    best_dt = 0;
+    for (size_t r = 0; r < ARR_LEN(grid_rows); ++r)
+        for (size_t c = 0; c < ARR_LEN(grid_cols); ++c)
+        {
+            probe.block_rows = grid_rows[r];
+            probe.block_cols = grid_cols[c];
+            if ((err = time_solve(&dt, pack_knapsack_mpi, &probe, sample_weight, &sample)) != OK)
+                goto out;
+
+            if (rank == 0 && log)
+                fprintf(log, "mpi rows=%lu cols=%lu dt=%lf\n",
+                        probe.block_rows, probe.block_cols, dt);
+            if ((r == 0 && c == 0) || dt < best_dt)
+            {
+                best_dt = dt;
+                best->block_rows = probe.block_rows;
+                best->block_cols = probe.block_cols;
+            }
+        }
+
+out:
+    drop_items(&sample);
+    return err;
+}
@@ -0,0 +1,152 @@
+#include <assert.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+#include <omp.h>
+
+#include <macro.h>
+#include <knapsack.h>
+#include <tune.h>
+
+#define NO_ITEM UINT32_MAX
+
+/*
+ * Strips shorter than this are not worth a worksharing barrier, so items
+ * lighter than this are handled by one thread.
+ */
+#define OMP_MIN_STRIP 4096
+
+/*
+ * Unbounded knapsack over one row: dp[c] is the best value of capacity c
+ * using any number of copies of the items seen so far. For one item,
+ * dp[c] depends on dp[c - w] of the same pass, so the capacities are
+ * walked upwards in strips of w: cells within a strip are independent
+ * (and vectorise), strips follow one another.
+ *
+ * last[c] is the last item that improved dp[c]; following it down from
+ * max_weight yields an optimal multiset.
+ */
+static void
+update_strip(int_t *restrict dp, uint32_t *restrict last,
+             size_t a, size_t b, weight_t w, value_t v, uint32_t idx)
+{
+    #pragma omp simd
+    for (size_t c = a; c < b; ++c)
+    {
+        const int_t y = dp[c - w] + v;
+        if (dp[c] < y)
+        {
+            dp[c] = y;
+            last[c] = idx;
+        }
+    }
+}
+
+static error_t
+trace_unbounded(knapsack_t *knapsack, const items_t *items, const uint32_t *last)
+{
+    size_t *copies = calloc(items->count + 1, sizeof(size_t));
+    if (!copies)
+        return MEM_ERR;
+
+    for (weight_t c = knapsack->max_weight; last[c] != NO_ITEM;)
+    {
+        ++copies[last[c]];
+        c -= items->arr[last[c]].weight;
+    }
+
+    error_t err = OK;
+    for (size_t i = items->count; err == OK && i > 0; --i)
+        if (copies[i - 1])
+            err = add_copies_to_knapsack(knapsack, &items->arr[i - 1], copies[i - 1]);
+
+    free(copies);
+    return err;
+}
+
+static error_t
+pack_unbounded_with(knapsack_t *knapsack, double *dt, const items_t *items,
+                    int num_threads)
+{
+    assert(knapsack && items);
+
+    if (items->count >= NO_ITEM)
+        return ARG_ERR;
+
+    // A weightless item with value would fit infinitely often.
+    for (size_t i = 0; i < items->count; ++i)
+        if (items->arr[i].weight == 0 && items->arr[i].value > 0)
+            return ARG_ERR;
+
+    const size_t num_cols = knapsack->max_weight + 1;
+    int_t *dp = calloc(num_cols, sizeof(int_t));
+    uint32_t *last = malloc(num_cols * sizeof(uint32_t));
+    if (!dp || !last)
+    {
+        free(last);
+        free(dp);
+        return MEM_ERR;
+    }
+
+    for (size_t c = 0; c < num_cols; ++c)
+        last[c] = NO_ITEM;
+
+    double t1 = omp_get_wtime();
+
+    // Weightless items are worthless here; they are left out.
+    for (size_t i = 0; i < items->count; ++i)
+    {
+        const weight_t w = items->arr[i].weight;
+        const value_t  v = items->arr[i].value;
+        if (w == 0 || w >= num_cols)
+            continue;
+
+        if (num_threads == 1 || w < OMP_MIN_STRIP)
+        {
+            for (size_t a = w; a < num_cols; a += w)
+                update_strip(dp, last, a, min(a + w, num_cols), w, v, i);
+            continue;
+        }
+
+        #pragma omp parallel num_threads(num_threads)
+        for (size_t a = w; a < num_cols; a += w)
+        {
+            const size_t b = min(a + w, num_cols);
+
+            #pragma omp for simd schedule(static)
+            for (size_t c = a; c < b; ++c)
+            {
+                const int_t y = dp[c - w] + v;
+                if (dp[c] < y)
+                {
+                    dp[c] = y;
+                    last[c] = i;
+                }
+            }
+        }
+    }
+
+    error_t err = trace_unbounded(knapsack, items, last);
+
+    *dt = omp_get_wtime() - t1;
+
+    free(last);
+    free(dp);
+
+    return err;
+}
+
+error_t
+pack_knapsack_unbounded(knapsack_t *knapsack, double *dt, const items_t *items)
+{
+    return pack_unbounded_with(knapsack, dt, items, 1);
+}
+
+error_t
+pack_knapsack_unbounded_omp(knapsack_t *knapsack, double *dt, const items_t *items)
+{
+    tune_t tune;
+    find_tune(&tune, knapsack->tunes, knapsack->max_weight, items->count);
+
+    return pack_unbounded_with(knapsack, dt, items, tune.num_threads);
+}
@@ -1,10 +1,128 @@
 #include <omp.h>
 
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include <float.h>
 #include <stdio.h>
+#include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
 
 #define NMAX 1000
-#define CHUNK_SIZE 100
+
+#define MATRIX_ALIGN 64
+#define SUM_BLOCK 512
+
+#define DEFAULT_SEED 23
+
+typedef struct
+{
+    size_t n;
+    size_t stride;
+    double *data;
+} matrix_t;
+
+#define AT(m, i, j) \
+    ((m)->data[(i) * (m)->stride + (j)])
+
+#define ROW_PTR(m, i) \
+    (&(m)->data[(i) * (m)->stride])
+
+static int
+alloc_matrix(matrix_t *m, size_t n)
+{
+    const size_t per_line = MATRIX_ALIGN / sizeof(double);
+
+    m->n = n;
+    m->stride = (n + per_line - 1) / per_line * per_line;
+    m->data = aligned_alloc(MATRIX_ALIGN, m->stride * n * sizeof(double));
+
+    return m->data ? 0 : -1;
+}
+
+static void
+free_matrix(matrix_t *m)
+{
+    free(m->data);
+    m->data = NULL;
+}
+
+static uint64_t
+splitmix64(uint64_t *state)
+{
+    uint64_t z = (*state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+static uint64_t
+xorshift64(uint64_t *state)
+{
+    uint64_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    return *state = x;
+}
+
+// Every row gets its own stream derived from (seed, row), so the contents
+// do not depend on the thread count or the schedule used to fill them.
+static void
+fill_matrix(matrix_t *m, uint64_t seed)
+{
+    size_t i = 0, j = 0;
+
+    #pragma omp parallel for schedule(static) private(i, j)
+    for (i = 0; i < m->n; ++i)
+    {
+        uint64_t state = seed ^ (i * 0xD1B54A32D192ED03ULL);
+        state = splitmix64(&state) | 1;
+
+        double *row = ROW_PTR(m, i);
+        for (j = 0; j < m->n; ++j)
+            row[j] = (double)(xorshift64(&state) % 23);
+    }
+}
+
+static double
+row_sum(const double *row, size_t n)
+{
+    double sum = 0;
+    for (size_t b = 0; b < n; b += SUM_BLOCK)
+    {
+        const size_t e = (b + SUM_BLOCK < n) ? b + SUM_BLOCK : n;
+
+        double block = 0;
+        #pragma omp simd aligned(row : MATRIX_ALIGN) reduction(+:block)
+        for (size_t j = b; j < e; ++j)
+            block += row[j];
+
+        sum += block;
+    }
+    return sum;
+}
+
+typedef struct
+{
+    const char *name;
+    omp_sched_t kind;
+} sched_t;
+
+static const sched_t
+schedules[] = {
+    { "static",  omp_sched_static  },
+    { "dynamic", omp_sched_dynamic },
+    { "guided",  omp_sched_guided  },
+};
+
+static const int
+chunk_sizes[] = { 0, 1, 16, 64, 256 };
+
+#define ARR_LEN(a) \
+    (sizeof(a) / sizeof((a)[0]))
 
 void
 task1(void)
@@ -27,22 +145,10 @@ task1(void)
     printf("dt=%lf\n", dt);
 }
 
-void
-task2(void)
+static void
+task2_run(const matrix_t *a, double *smax_out, double *total_out)
 {
-    puts("task2:");
-
-    size_t i = 0, j = 0;
-    double a[NMAX][NMAX];
-
-    #pragma omp parallel shared(a) private(i, j)
-    {
-        #pragma omp for schedule(dynamic, CHUNK_SIZE)
-        for (i = 0; i < NMAX; ++i)
-            for (j = 0; j < NMAX; ++j)
-                a[i][j] = rand() % 23;
-    }
-
+    size_t i = 0;
     double sum = 0, smax = 0, total = 0;
 
 #ifndef _LAB_02_CRIT_
@@ -50,15 +156,12 @@ task2(void)
     omp_init_lock(&lock);
 #endif
 
-    #pragma omp parallel shared(a) private(i, j, sum)
+    #pragma omp parallel shared(a) private(i, sum)
     {
-        #pragma omp for ordered \
-                schedule(dynamic, CHUNK_SIZE) reduction(+:total)
-        for (i = 0; i < NMAX; ++i)
+        #pragma omp for schedule(runtime) reduction(+:total)
+        for (i = 0; i < a->n; ++i)
         {
-            sum = 0;
-            for (j = 0; j < NMAX; ++j)
-                sum += a[i][j];
+            sum = row_sum(ROW_PTR(a, i), a->n);
 
             if (sum > smax)
 #ifdef _LAB_02_CRIT_
@@ -74,11 +177,7 @@ task2(void)
             }
 #endif
 
-            #pragma omp atomic
             total += sum;
-
-            #pragma omp ordered
-            printf("th=%d; s[%lu] = %lf\n", omp_get_thread_num(), i, sum);
         }
     }
 
@@ -86,57 +185,242 @@ task2(void)
     omp_destroy_lock(&lock);
 #endif
 
-    printf("smax=%lf, total=%lf\n", smax, total);
+    *smax_out = smax;
+    *total_out = total;
 }
 
 void
-task3(void)
+task2(size_t n)
 {
-    puts("task3:");
+    puts("task2:");
 
-    double min_val = 0;
-    const size_t n_max = NMAX / 4;
+    matrix_t a = { 0 };
+    if (alloc_matrix(&a, n) != 0)
+    {
+        printf("failed to allocate %lux%lu matrix\n", n, n);
+        return;
+    }
 
-    size_t i = 0, j = 0;
-    double a[n_max][n_max], b[n_max][n_max];
+    fill_matrix(&a, DEFAULT_SEED);
+
+    puts("schedule,chunk,n,dt,smax,total");
+    for (size_t s = 0; s < ARR_LEN(schedules); ++s)
+        for (size_t c = 0; c < ARR_LEN(chunk_sizes); ++c)
+        {
+            omp_set_schedule(schedules[s].kind, chunk_sizes[c]);
+
+            double smax = 0, total = 0;
+            double t1 = omp_get_wtime();
+            task2_run(&a, &smax, &total);
+            double t2 = omp_get_wtime();
+
+            printf("%s,%d,%lu,%lf,%lf,%lf\n", schedules[s].name,
+                    chunk_sizes[c], n, t2 - t1, smax, total);
+        }
+
+    free_matrix(&a);
+}
+
+// Non-temporal stores bypass the cache on the way to b: the copy is never
+// read back here, so there is no point in evicting a for it.
+static void
+copy_row_nt(double *restrict dst, const double *restrict src, size_t n)
+{
+    size_t j = 0;
+#ifdef __SSE2__
+    for (; j + 2 <= n; j += 2)
+        _mm_stream_pd(&dst[j], _mm_load_pd(&src[j]));
+#endif
+    for (; j < n; ++j)
+        dst[j] = src[j];
+}
 
-    #pragma omp parallel shared(a) private(i, j)
+static double
+row_min(const double *row, size_t n)
+{
+    double m = DBL_MAX;
+    #pragma omp simd aligned(row : MATRIX_ALIGN) reduction(min:m)
+    for (size_t j = 0; j < n; ++j)
+        m = row[j] < m ? row[j] : m;
+    return m;
+}
+
+static double
+row_min_copy_nt(double *restrict dst, const double *restrict src, size_t n)
+{
+    double m = DBL_MAX;
+    size_t j = 0;
+#ifdef __SSE2__
+    __m128d vm = _mm_set1_pd(DBL_MAX);
+    for (; j + 2 <= n; j += 2)
     {
-        #pragma omp for schedule(dynamic, CHUNK_SIZE)
-        for (i = 0; i < n_max; ++i)
-            for (j = 0; j < n_max; ++j)
-                a[i][j] = rand() % 23;
+        __m128d v = _mm_load_pd(&src[j]);
+        vm = _mm_min_pd(vm, v);
+        _mm_stream_pd(&dst[j], v);
     }
 
-    #pragma omp parallel shared(a, b) private(i, j)
+    double lanes[2];
+    _mm_storeu_pd(lanes, vm);
+    m = lanes[0] < lanes[1] ? lanes[0] : lanes[1];
+#endif
+    for (; j < n; ++j)
     {
-        #pragma omp sections
-        {
-            #pragma omp section
-            for (i = 0; i < n_max; ++i)
-                for (j = 0; j < n_max; ++j)
+        m = src[j] < m ? src[j] : m;
+        dst[j] = src[j];
+    }
+    return m;
+}
+
+static void
+nt_fence(void)
+{
+#ifdef __SSE2__
+    _mm_sfence();
+#endif
+}
+
+typedef enum
+{
+    K_STREAM_COPY,
+    K_MIN,
+    K_COPY_NT,
+    K_FUSED_NT,
+} kernel_t;
+
+static const char *
+kernel_names[] = { "stream_copy", "min", "copy_nt", "min_copy_nt" };
+
+// Words moved per matrix element, counted the way STREAM does (no write
+// allocate traffic).
+static const int
+kernel_words[] = { 2, 1, 2, 2 };
+
+static double
+task3_run(kernel_t k, const matrix_t *a, matrix_t *b)
+{
+    size_t i = 0;
+    double min_val = DBL_MAX;
+
+    switch (k)
+    {
+        case K_STREAM_COPY:
+            #pragma omp parallel for schedule(static)
+            for (i = 0; i < a->n; ++i)
+            {
+                double *restrict dst = ROW_PTR(b, i);
+                const double *restrict src = ROW_PTR(a, i);
+                for (size_t j = 0; j < a->n; ++j)
+                    dst[j] = src[j];
+            }
+            break;
+
+        case K_MIN:
+            #pragma omp parallel for schedule(static) reduction(min:min_val)
+            for (i = 0; i < a->n; ++i)
+            {
+                double m = row_min(ROW_PTR(a, i), a->n);
+                min_val = m < min_val ? m : min_val;
+            }
+            break;
+
+        case K_COPY_NT:
+            #pragma omp parallel
+            {
+                #pragma omp for schedule(static)
+                for (i = 0; i < a->n; ++i)
+                    copy_row_nt(ROW_PTR(b, i), ROW_PTR(a, i), a->n);
+                nt_fence();
+            }
+            break;
+
+        case K_FUSED_NT:
+            #pragma omp parallel
+            {
+                #pragma omp for schedule(static) reduction(min:min_val)
+                for (i = 0; i < a->n; ++i)
                 {
-                    if (a[i][j] < min_val)
-                        if (a[i][j] < min_val)
-                            min_val = a[i][j];
+                    double m = row_min_copy_nt(ROW_PTR(b, i), ROW_PTR(a, i), a->n);
+                    min_val = m < min_val ? m : min_val;
                 }
+                nt_fence();
+            }
+            break;
+    }
+
+    return min_val;
+}
+
+#define NTIMES 5
+
+void
+task3(size_t n)
+{
+    puts("task3:");
+
+    // A quarter of n, but never an empty matrix.
+    const size_t n_max = (n >= 4) ? n / 4 : 1;
+
+    matrix_t a = { 0 }, b = { 0 };
+    if (alloc_matrix(&a, n_max) != 0 || alloc_matrix(&b, n_max) != 0)
+    {
+        printf("failed to allocate %lux%lu matrices\n", n_max, n_max);
+        goto out;
+    }
+
+    fill_matrix(&a, DEFAULT_SEED);
+    fill_matrix(&b, 0);
 
-            #pragma omp section
-            for (i = 0; i < n_max; ++i)
-                for (j = 0; j < n_max; ++j)
-                    b[i][j] = a[i][j];
+    const double elems = (double)n_max * (double)n_max;
+    double stream_gbs = 0;
+
+    puts("kernel,n_max,dt,gbs,of_stream,min");
+    for (kernel_t k = K_STREAM_COPY; k <= K_FUSED_NT; ++k)
+    {
+        double best = 0, min_val = 0;
+        for (int r = 0; r < NTIMES; ++r)
+        {
+            double t1 = omp_get_wtime();
+            min_val = task3_run(k, &a, &b);
+            double dt = omp_get_wtime() - t1;
+
+            if (r == 0 || dt < best)
+                best = dt;
         }
+
+        double gbs = kernel_words[k] * sizeof(double) * elems / best * 1e-9;
+        if (k == K_STREAM_COPY)
+            stream_gbs = gbs;
+
+        printf("%s,%lu,%lf,%lf,%lf,", kernel_names[k],
+                n_max, best, gbs, gbs / stream_gbs);
+        if (k == K_MIN || k == K_FUSED_NT)
+            printf("%lf\n", min_val);
+        else
+            printf("%s\n", "-");
     }
 
-    printf("min=%lf\n", min_val);
+out:
+    free_matrix(&b);
+    free_matrix(&a);
 }
 
 int
-main(void)
+main(int argc, char *argv[])
 {
+    size_t n = NMAX;
+    if (argc > 2)
+    {
+        printf("Usage: %s [n]\n", argv[0]);
+        return 1;
+    }
+    if (argc == 2)
+        n = strtoul(argv[1], NULL, 10);
+    if (n == 0)
+        n = NMAX;
+
     task1();
-    task2();
-    task3();
+    task2(n);
+    task3(n);
 
     return 0;
 }
@@ -1,5 +1,18 @@
 #include <mpi.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MSG_SIZE_MIN 1
+#define MSG_SIZE_MAX (4 << 20)
+
+#define COLL_COUNT_MIN 1
+#define COLL_COUNT_MAX (1 << 16)
+
+#define WARMUP_ITERS 10
+#define BYTES_PER_ITER_BUDGET (64 << 20)
+#define MAX_ITERS 1000
+#define MIN_ITERS 10
 
 void
 task1(void)
@@ -41,6 +54,281 @@ task2(void)
         MPI_Send(&world_rank, 1, MPI_INT, 0, 0, MPI_COMM_WORLD);
 }
 
+static int
+num_iters(size_t bytes)
+{
+    size_t iters = BYTES_PER_ITER_BUDGET / (bytes ? bytes : 1);
+    if (iters > MAX_ITERS)
+        iters = MAX_ITERS;
+    if (iters < MIN_ITERS)
+        iters = MIN_ITERS;
+    return (int)iters;
+}
+
+// Slowest rank wins: a collective is only complete when the last rank is.
+static double
+max_over_ranks(double t)
+{
+    double t_max = 0;
+    MPI_Reduce(&t, &t_max, 1, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+    return t_max;
+}
+
+void
+task3(void)
+{
+    int world_size = 0;
+    MPI_Comm_size(MPI_COMM_WORLD, &world_size);
+
+    int world_rank = 0;
+    MPI_Comm_rank(MPI_COMM_WORLD, &world_rank);
+
+    if (world_size < 2)
+    {
+        if (world_rank == 0)
+            puts("pingpong: skipped, needs at least 2 ranks");
+        return;
+    }
+
+    char *buf = malloc(MSG_SIZE_MAX);
+    if (!buf)
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    memset(buf, 0, MSG_SIZE_MAX);
+
+    if (world_rank == 0)
+        puts("bench,bytes,iters,latency_us,bandwidth_mbs");
+
+    for (size_t bytes = MSG_SIZE_MIN; bytes <= MSG_SIZE_MAX; bytes *= 2)
+    {
+        const int iters = num_iters(bytes);
+        double t1 = 0;
+
+        MPI_Barrier(MPI_COMM_WORLD);
+        for (int i = -WARMUP_ITERS; i < iters; ++i)
+        {
+            if (i == 0)
+                t1 = MPI_Wtime();
+
+            if (world_rank == 0)
+            {
+                MPI_Send(buf, bytes, MPI_CHAR, 1, 0, MPI_COMM_WORLD);
+                MPI_Recv(buf, bytes, MPI_CHAR, 1, 0, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+            }
+            else if (world_rank == 1)
+            {
+                MPI_Recv(buf, bytes, MPI_CHAR, 0, 0, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+                MPI_Send(buf, bytes, MPI_CHAR, 0, 0, MPI_COMM_WORLD);
+            }
+        }
+        double dt = MPI_Wtime() - t1;
+
+        if (world_rank == 0)
+        {
+            double one_way = dt / iters / 2;
+            printf("pingpong,%lu,%d,%lf,%lf\n", bytes, iters,
+                    one_way * 1e6, bytes / one_way * 1e-6);
+        }
+    }
+
+    free(buf);
+}
+
+typedef enum
+{
+    COLL_P2P_GATHER,
+    COLL_GATHER,
+    COLL_ALLREDUCE,
+    COLL_BCAST,
+} coll_t;
+
+static const char *
+coll_names[] = { "p2p_gather", "gather", "allreduce", "bcast" };
+
+// Ranks do not synchronise between message sizes, so the p2p gather tags
+// every size apart: a fast rank's next message must not match a receive
+// posted for the current, smaller one.
+static void
+run_coll(coll_t op, int *send, int *recv, int count, int tag,
+         int world_rank, int world_size)
+{
+    switch (op)
+    {
+        case COLL_P2P_GATHER:
+            if (world_rank == 0)
+            {
+                memcpy(recv, send, count * sizeof(int));
+                for (int i = 1; i < world_size; ++i)
+                {
+                    MPI_Status status = { 0 };
+                    MPI_Probe(MPI_ANY_SOURCE, tag, MPI_COMM_WORLD, &status);
+                    MPI_Recv(recv + (size_t)status.MPI_SOURCE * count, count, MPI_INT,
+                        status.MPI_SOURCE, tag, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+                }
+            }
+            else
+                MPI_Send(send, count, MPI_INT, 0, tag, MPI_COMM_WORLD);
+            break;
+
+        case COLL_GATHER:
+            MPI_Gather(send, count, MPI_INT, recv, count, MPI_INT, 0, MPI_COMM_WORLD);
+            break;
+
+        case COLL_ALLREDUCE:
+            MPI_Allreduce(send, recv, count, MPI_INT, MPI_SUM, MPI_COMM_WORLD);
+            break;
+
+        case COLL_BCAST:
+            MPI_Bcast(send, count, MPI_INT, 0, MPI_COMM_WORLD);
+            break;
+    }
+}
+
+void
+task4(void)
+{
+    int world_size = 0;
+    MPI_Comm_size(MPI_COMM_WORLD, &world_size);
+
+    int world_rank = 0;
+    MPI_Comm_rank(MPI_COMM_WORLD, &world_rank);
+
+    int *send = calloc(COLL_COUNT_MAX, sizeof(int));
+    int *recv = calloc((size_t)COLL_COUNT_MAX * world_size, sizeof(int));
+    if (!send || !recv)
+        MPI_Abort(MPI_COMM_WORLD, 1);
+
+    if (world_rank == 0)
+        puts("bench,op,procs,bytes,iters,time_us");
+
+    for (coll_t op = COLL_P2P_GATHER; op <= COLL_BCAST; ++op)
+        for (int count = COLL_COUNT_MIN, tag = 0; count <= COLL_COUNT_MAX; count *= 4, ++tag)
+        {
+            const size_t bytes = count * sizeof(int);
+            const int iters = num_iters(bytes * world_size);
+
+            for (int i = 0; i < WARMUP_ITERS; ++i)
+                run_coll(op, send, recv, count, tag, world_rank, world_size);
+
+            MPI_Barrier(MPI_COMM_WORLD);
+            double t1 = MPI_Wtime();
+            for (int i = 0; i < iters; ++i)
+                run_coll(op, send, recv, count, tag, world_rank, world_size);
+            double dt = max_over_ranks((MPI_Wtime() - t1) / iters);
+
+            if (world_rank == 0)
+                printf("coll,%s,%d,%lu,%d,%lf\n", coll_names[op],
+                        world_size, bytes, iters, dt * 1e6);
+        }
+
+    free(recv);
+    free(send);
+}
+
+static volatile double
+compute_sink;
+
+static void
+compute_for(double seconds)
+{
+    double x = 0;
+    double t1 = MPI_Wtime();
+    while (MPI_Wtime() - t1 < seconds)
+        for (int i = 0; i < 1000; ++i)
+            x += i * 0.5;
+    compute_sink = x;
+}
+
+static double
+exchange(char *sbuf, char *rbuf, size_t bytes, int peer, int compute, double t_comp)
+{
+    MPI_Request reqs[2];
+
+    double t1 = MPI_Wtime();
+    MPI_Irecv(rbuf, bytes, MPI_CHAR, peer, 0, MPI_COMM_WORLD, &reqs[0]);
+    MPI_Isend(sbuf, bytes, MPI_CHAR, peer, 0, MPI_COMM_WORLD, &reqs[1]);
+    if (compute)
+        compute_for(t_comp);
+    MPI_Waitall(2, reqs, MPI_STATUSES_IGNORE);
+
+    return MPI_Wtime() - t1;
+}
+
+// Overlap efficiency is the share of the shorter phase hidden behind the
+// longer one: 1 means communication came for free, 0 means none of it did.
+void
+task5(void)
+{
+    int world_size = 0;
+    MPI_Comm_size(MPI_COMM_WORLD, &world_size);
+
+    int world_rank = 0;
+    MPI_Comm_rank(MPI_COMM_WORLD, &world_rank);
+
+    if (world_size < 2)
+    {
+        if (world_rank == 0)
+            puts("overlap: skipped, needs at least 2 ranks");
+        return;
+    }
+
+    const int peer = world_rank ^ 1;
+    const int active = peer < world_size;
+
+    char *sbuf = calloc(MSG_SIZE_MAX, 1);
+    char *rbuf = calloc(MSG_SIZE_MAX, 1);
+    if (!sbuf || !rbuf)
+        MPI_Abort(MPI_COMM_WORLD, 1);
+
+    if (world_rank == 0)
+        puts("bench,bytes,iters,comm_us,comp_us,overlap_us,efficiency");
+
+    for (size_t bytes = 1024; bytes <= MSG_SIZE_MAX; bytes *= 4)
+    {
+        const int iters = num_iters(bytes);
+        double t_comm = 0, t_comp = 0, t_both = 0;
+
+        MPI_Barrier(MPI_COMM_WORLD);
+        if (active)
+        {
+            for (int i = 0; i < WARMUP_ITERS; ++i)
+                exchange(sbuf, rbuf, bytes, peer, 0, 0);
+            for (int i = 0; i < iters; ++i)
+                t_comm += exchange(sbuf, rbuf, bytes, peer, 0, 0);
+            t_comm /= iters;
+
+            // Both peers must agree on the compute length, or the longer
+            // one will wait on the shorter and skew the overlap figure.
+            MPI_Allreduce(MPI_IN_PLACE, &t_comm, 1, MPI_DOUBLE, MPI_MAX, MPI_COMM_WORLD);
+
+            for (int i = 0; i < iters; ++i)
+            {
+                double t1 = MPI_Wtime();
+                compute_for(t_comm);
+                t_comp += MPI_Wtime() - t1;
+
+                t_both += exchange(sbuf, rbuf, bytes, peer, 1, t_comm);
+            }
+            t_comp /= iters;
+            t_both /= iters;
+        }
+        else
+            MPI_Allreduce(MPI_IN_PLACE, &t_comm, 1, MPI_DOUBLE, MPI_MAX, MPI_COMM_WORLD);
+
+        if (world_rank == 0)
+        {
+            double shorter = t_comm < t_comp ? t_comm : t_comp;
+            double hidden = t_comm + t_comp - t_both;
+            double eff = shorter > 0 ? hidden / shorter : 0;
+
+            printf("overlap,%lu,%d,%lf,%lf,%lf,%lf\n", bytes, iters,
+                    t_comm * 1e6, t_comp * 1e6, t_both * 1e6, eff);
+        }
+    }
+
+    free(rbuf);
+    free(sbuf);
+}
+
 int
 main(int argc, char **argv)
 {
@@ -49,6 +337,11 @@ main(int argc, char **argv)
     task1();
     task2();
 
+    MPI_Barrier(MPI_COMM_WORLD);
+    task3();
+    task4();
+    task5();
+
     MPI_Finalize();
     return 0;
 }